@@ -1,10 +1,21 @@
 // include/airplay_streamer.hpp
 #pragma once
 
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <vector>
 #include <string>
+#include <type_traits>
+
+#include "frame_extras.hpp"
+#include "frame_queue.hpp"
+#include "frame_stream.hpp"
+#include "frame_view.hpp"
+#include "tensor.hpp"
+#include "video_frame.hpp"
 
 struct AVFrame;
 
@@ -18,23 +29,314 @@ namespace ender::airplay_streamer {
 
     using AVFrameCallback = std::function<void(std::shared_ptr<AVFrame>, int64_t timestamp)>;
 
+    class DecoderBackend;
+
+    using DecoderBackendFactory = std::function<std::unique_ptr<DecoderBackend>()>;
+
+    // 自适应降级的级别，逐级递进
+    enum class ShedLevel {
+        Full,           // 完整解码
+        SkipLoopFilter, // 跳过去块滤波
+        SkipNonRef,     // 再跳过非参考帧
+        KeyframesOnly   // 只解关键帧
+    };
+
+    // 会话解码落后时自动降级，追上后逐级恢复
+    struct SheddingPolicy {
+        bool enabled = true;
+        int max_lag_ms = 250;    // 发送端时间戳延迟超过它（或队列过半）视为落后
+        int recover_lag_ms = 80; // 延迟低于它且队列基本为空视为追上
+    };
+
+    enum class Orientation {
+        Landscape,
+        Portrait
+    };
+
+    // 流参数，发送端每次开始推流、旋转屏幕或改变分辨率时会重新下发
+    struct StreamFormat {
+        uint64_t session_id = 0;
+        int width = 0;  // 编码分辨率
+        int height = 0;
+        int source_width = 0; // 发送端屏幕尺寸（当前方向）
+        int source_height = 0;
+        Orientation orientation = Orientation::Landscape;
+        int profile = 0; // H.264 profile_idc / level_idc
+        int level = 0;
+
+        // avcC 记录，仅在回调期间有效
+        const uint8_t *avcc = nullptr;
+        size_t avcc_size = 0;
+    };
+
+    using StreamFormatCallback = std::function<void(const StreamFormat &format)>;
+
+    // 会话开始 / 结束，参数是会话 id（和 SessionStats、FrameStreamOptions 里的一致）
+    using SessionCallback = std::function<void(uint64_t session_id)>;
+
+    // 解码后顺带生成的多级缩小帧，挂在交付的帧上（见 frame_extras.hpp）
+    struct OutputLadder {
+        std::vector<int> divisors; // 例如 {2, 4} 表示 1/2 和 1/4；只支持 2 的幂，空表示不生成
+        bool deliver_full = true;  // false 时不交付原尺寸帧，改为交付第一级（其余各级同样挂在它上面）
+    };
+
+    // 检测画面四周的黑边（竖屏设备镜像到横屏分辨率时的左右黑边等），只交付有画面的区域
+    struct ContentCrop {
+        bool enabled = false;
+        // true：交付的帧直接裁好（av_frame_apply_cropping，不复制像素），之后的缩小帧、张量等也只处理画面区域；
+        // false：只设置 AVFrame::crop_top/bottom/left/right，由消费者自己处理
+        bool apply = true;
+        int black_level = 24; // 亮度不超过它视为黑边（有限范围的黑为 16）
+        int interval = 60;    // 每隔多少帧重新检测；分辨率变化时立即检测
+    };
+
+    // 逐帧亮度统计（直方图、均值/方差、黑屏/纯色/静止），结果挂在帧上（FrameExtras::analytics）并汇总到 SessionStats
+    struct Analytics {
+        bool enabled = false;
+        int row_step = 8;            // 每隔多少行采样一行
+        int column_step = 4;         // 直方图在采样行内每隔多少像素取一点
+        int black_level = 24;        // 亮度不超过它视为黑
+        float blank_variance = 4.0f; // 方差不超过它视为纯色
+    };
+
+    // 与上一次交付的帧逐 tile 比较亮度，结果挂在帧上（FrameExtras::tiles）
+    struct DirtyTracking {
+        bool enabled = false;
+        int tile_size = 64;              // 像素，取 16 的倍数
+        int threshold = 0;               // 亮度差不超过它视为没变，用来忽略编码噪声
+        bool suppress_unchanged = false; // 没有任何 tile 变化时不交付这一帧
+    };
+
+    // 抽帧方式：只需要低帧率画面时让 CPU 占用随采样率而不是发送端帧率变化
+    enum class SamplingMode {
+        All,       // 解码并交付每一帧
+        Keyframes, // 只解码关键帧（skip_frame = AVDISCARD_NONKEY），其余帧在入队前就丢掉
+        // 每隔 interval_ms 交付一帧；中间的非参考帧直接丢掉，参考帧只解码不交付。
+        // iOS 的镜像流几乎每一帧都是参考帧，所以解码量基本不减少，省下的是裁剪、缩放、转换和回调
+        Interval
+    };
+
+    struct Sampling {
+        SamplingMode mode = SamplingMode::All;
+        int interval_ms = 1000;
+    };
+
+    // 解码后的帧交给 on_video_data 的方式
+    enum class DeliveryMode {
+        Direct,     // 在解码线程上逐帧同步回调，消费者慢会拖慢解码
+        LatestFrame // 放进单槽信箱由单独的线程回调，消费者跟不上时只拿最新一帧，旧帧丢弃
+    };
+
+    // 压缩帧的 NAL 封装方式
+    enum class PacketFormat {
+        AnnexB, // 00 00 00 01 起始码
+        Avcc    // 4 字节大端长度前缀，即 AirPlay 原始格式
+    };
+
+    // 解密后、解码前的一帧 H.264 数据，仅在回调期间有效
+    struct VideoPacket {
+        uint64_t session_id = 0;
+
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+        PacketFormat format = PacketFormat::AnnexB;
+
+        int64_t pts = 0; // 发送端 NTP 时间换算到本地时钟，单位微秒
+        bool keyframe = false;
+
+        // 当前参数集：Avcc 时是 avcC 记录，AnnexB 时是带起始码的 SPS/PPS
+        const uint8_t *config = nullptr;
+        size_t config_size = 0;
+        bool config_changed = false; // 这一帧之前刚收到新的参数集
+    };
+
+    using VideoPacketCallback = std::function<void(const VideoPacket &packet)>;
+
+    // 解码器多线程方式
+    enum class DecoderThreadType {
+        Auto,  // 按分辨率和会话数自动选择
+        Frame, // 帧级并行，吞吐高，但每个额外线程增加一帧延迟
+        Slice  // 片级并行，不增加延迟
+    };
+
+    struct DecoderThreading {
+        DecoderThreadType type = DecoderThreadType::Auto;
+        int thread_count = 0; // 0 表示自动；Auto 模式下作为上限
+        bool fast = false;    // AV_CODEC_FLAG2_FAST，允许不符合规范的加速
+    };
+
     struct Config {
         std::string server_name = "AirplayServer";
         std::vector<uint8_t> hw_address = {0x48, 0x5D, 0x60, 0x7C, 0xEE, 0x22};
 
+        // 低延迟模式：解码器 LOW_DELAY、不用帧线程，镜像 socket 阻塞读并加大接收缓冲
         bool low_latency = false;
 
+        // 解码器在收到第一个参数集（知道分辨率）时按这里的设置打开
+        DecoderThreading decoder_threading;
+
+        // 创建每个会话的解码后端（见 decoder_backend.hpp），不设置时使用 libavcodec 的 H.264 解码器
+        DecoderBackendFactory decoder_backend;
+
+        // 每个会话待解码队列的容量（以帧为单位），队列满时丢帧直到下一个关键帧
+        size_t decode_queue_capacity = 16;
+
+        SheddingPolicy shedding;
+        Sampling sampling;
+
+        // 解码器导出运动矢量（AV_CODEC_FLAG2_EXPORT_MVS），按宏块汇总后挂在帧上（FrameExtras::motion）
+        bool export_motion_vectors = false;
+
+        // on_video_data / on_audio_data / log_callback 只由 AirplayStreamer（FunctionSink）使用，
+        // BasicAirplayStreamer<自定义 Sink> 改为调用 Sink 的 onVideo / onAudio / onLog
         AVFrameCallback on_video_data;
+        // 和 on_video_data 一样逐帧回调，帧包装成 VideoFrame，可以按需取 BGRA/NV12 等格式
+        VideoFrameCallback on_video_frame;
+        // 同步回调借用视图，不需要 FFmpeg 头文件；只设置这个回调且没有其他逐帧处理时，
+        // 解码器输出的帧直接借出，不包装 shared_ptr，也没有任何分配
+        FrameViewCallback on_frame_view;
         AVFrameCallback on_audio_data;
+        DeliveryMode delivery_mode = DeliveryMode::Direct;
+        ContentCrop content_crop;
+        Analytics analytics;
+        OutputLadder output_ladder;
+        DirtyTracking dirty_tracking;
+
+        // 直接输出模型输入张量（缩放、颜色转换和归一化一次完成），与 on_video_data 的帧一一对应；
+        // tensor_allocator 可以让张量写进调用方的缓冲，不设置时使用库内部的池
+        TensorSpec tensor;
+        TensorCallback on_tensor;
+        TensorAllocator tensor_allocator;
+
+        // 解密后直接回调压缩帧，在 mirror 线程上同步调用；
+        // 没有逐帧回调（on_video_data / on_video_frame / on_frame_view / on_tensor）、
+        // 也没有订阅者接收这个会话的帧时，只走这个回调，不创建解码器
+        VideoPacketCallback on_video_packet;
+        PacketFormat packet_format = PacketFormat::AnnexB;
+
+        // 流参数变化时回调，在按新参数解码出第一帧之前。
+        // 解码时在解码线程上调用，否则在 mirror 线程上调用
+        StreamFormatCallback on_stream_format_changed;
+
+        // 每个 AirPlay 连接建立 / 销毁时在 RAOP 连接线程上调用。on_session_started 在收到任何视频数据之前返回，
+        // 在这里订阅只接收这个会话的 FrameStream，会话从第一个参数集开始解码，不用等关键帧
+        SessionCallback on_session_started;
+        SessionCallback on_session_ended;
 
         std::function<void(LogLevel level, const char *)> log_callback = nullptr;
     };
 
-    class AirplayStreamer {
+    // 单个镜像会话的运行统计
+    struct SessionStats {
+        uint64_t session_id = 0;
+
+        size_t queue_depth = 0;      // 当前待解码的帧数
+        size_t queue_high_water = 0; // 队列出现过的最大深度
+        size_t queue_capacity = 0;
+
+        bool decoding = false; // 这个会话当前是否在解码（有逐帧回调，或有订阅者要它的帧）
+        int decoder_threads = 0;
+        DecoderThreadType decoder_thread_type = DecoderThreadType::Auto; // 实际选用的方式，单线程时为 Auto
+        std::string decoder_backend;                                     // 后端名称，还没打开时为空
+
+        // 每次送包解码（含取出输出帧）的耗时，微秒；开了帧线程时不等于单帧的解码时间
+        int64_t decode_time_avg_us = 0; // 指数滑动平均
+        int64_t decode_time_max_us = 0;
+        uint64_t decode_errors = 0;
+
+        ShedLevel shed_level = ShedLevel::Full;
+        uint64_t shed_escalations = 0; // 降级次数
+        uint64_t shed_recoveries = 0;  // 恢复次数
+
+        uint64_t packets_received = 0;
+        uint64_t packets_dropped = 0; // 因队列满而丢弃的帧
+        uint64_t packets_skipped = 0; // 按 Sampling 不需要、没有解码的帧
+        uint64_t frames_decoded = 0;
+        uint64_t frames_delivered = 0;   // 实际交给 on_video_data 的帧
+        uint64_t frames_overwritten = 0; // LatestFrame 模式下被新帧覆盖、没有交付的帧
+        uint64_t frames_unchanged = 0;   // 与上一次交付的帧相同的帧（开启 suppress_unchanged 时不交付）
+
+        // Analytics 汇总
+        uint64_t frames_analyzed = 0;
+        uint64_t black_frames = 0;
+        uint64_t blank_frames = 0;
+        uint64_t unchanged_run = 0; // 连续静止的帧数，画面卡住时持续增长
+        float luma_mean = 0.0f;     // 最近一帧的亮度均值
+
+        // ContentCrop 检测到的画面区域，没有开启或没有黑边时为整帧
+        int content_left = 0;
+        int content_top = 0;
+        int content_width = 0;
+        int content_height = 0;
+
+        // 从发送端打时间戳（已换算到本机时钟）到 on_video_data 返回的耗时，微秒；
+        // 没有样本时为 0
+        int64_t latency_last_us = 0;
+        int64_t latency_avg_us = 0; // 指数滑动平均
+        int64_t latency_max_us = 0;
+    };
+
+    struct SubscriberOptions {
+        std::string name; // 只用于日志和统计
+        size_t queue_capacity = 4;
+        DropPolicy drop_policy = DropPolicy::DropOldest;
+    };
+
+    using SubscriptionId = uint64_t;
+
+    struct SubscriberStats {
+        SubscriptionId id = 0;
+        std::string name;
+        size_t queue_depth = 0;
+        size_t queue_capacity = 0;
+        uint64_t frames_delivered = 0;
+        uint64_t frames_dropped = 0; // 队列满时按 drop_policy 丢掉的帧
+    };
+
+    // 库内部调用回调接收者的入口，由 BasicAirplayStreamer 按 Sink 类型在编译期生成；
+    // 为空的项表示 Sink 不接收这类数据
+    struct SinkHooks {
+        void *sink = nullptr;
+        void (*video)(void *sink, std::shared_ptr<AVFrame> &&frame, int64_t pts) = nullptr;
+        void (*audio)(void *sink, std::shared_ptr<AVFrame> &&frame, int64_t pts) = nullptr;
+        void (*log)(void *sink, LogLevel level, const char *message) = nullptr;
+
+        // FunctionSink 用：直接调用 Config 里的 std::function，不再经过上面的跳板多一次间接调用
+        const AVFrameCallback *video_function = nullptr;
+        const AVFrameCallback *audio_function = nullptr;
+        const std::function<void(LogLevel level, const char *)> *log_function = nullptr;
+
+        bool acceptsVideo() const { return video || video_function; }
+        bool acceptsAudio() const { return audio || audio_function; }
+        bool acceptsLog() const { return log || log_function; }
+
+        // 调用前先用 acceptsVideo() 等检查
+        void onVideo(std::shared_ptr<AVFrame> &&frame, const int64_t pts) const {
+            if (video_function) (*video_function)(std::move(frame), pts);
+            else video(sink, std::move(frame), pts);
+        }
+
+        void onAudio(std::shared_ptr<AVFrame> &&frame, const int64_t pts) const {
+            if (audio_function) (*audio_function)(std::move(frame), pts);
+            else audio(sink, std::move(frame), pts);
+        }
+
+        void onLog(const LogLevel level, const char *message) const {
+            if (log_function) (*log_function)(level, message);
+            else log(sink, level, message);
+        }
+    };
+
+    // 与回调类型无关的实现：RAOP/DNSSD、会话和解码
+    class StreamerCore {
     public:
-        explicit AirplayStreamer(const Config &config);
+        StreamerCore(const Config &config, SinkHooks hooks);
+
+        ~StreamerCore();
 
-        ~AirplayStreamer();
+        StreamerCore(const StreamerCore &) = delete;
+
+        StreamerCore &operator=(const StreamerCore &) = delete;
 
         // 启动服务线程
         void start() const;
@@ -45,8 +347,169 @@ namespace ender::airplay_streamer {
         // 是否正在运行中
         bool isRunning() const;
 
+        // 当前所有会话的统计快照
+        std::vector<SessionStats> sessionStats() const;
+
+        // 增加一个帧订阅者，与 on_video_data 收到相同的帧（共享引用，不复制）。
+        // 每个订阅者有自己的有界队列和回调线程，慢订阅者只会让自己丢帧。
+        // 会话在建立时决定是否解码：只用订阅、不设置 on_video_data 时要在连接建立前订阅
+        SubscriptionId subscribe(AVFrameCallback callback, SubscriberOptions options = {}) const;
+
+        // 增加一个由调用方拉取的订阅者：帧直接推进 queue，不创建回调线程，
+        // 容量和丢帧策略由 queue 决定；unsubscribe 时关闭队列
+        SubscriptionId subscribe(std::shared_ptr<FrameQueue> queue, std::string name = {}) const;
+
+        // 增加一个协程帧流：co_await stream->next() 等下一帧，由 stream 的执行器恢复；
+        // 流设置了 session_id 时只收这个会话的帧，会话结束或 unsubscribe 时流关闭
+        SubscriptionId subscribe(std::shared_ptr<FrameStream> stream) const;
+
+        // 取消订阅并等待它的回调线程退出；在它自己的回调里调用时不等待
+        void unsubscribe(SubscriptionId id) const;
+
+        std::vector<SubscriberStats> subscriberStats() const;
+
     private:
         class Impl;
         std::unique_ptr<Impl> impl_;
     };
+
+    // 使用 Config 里 on_video_data / on_audio_data / log_callback 的 Sink，AirplayStreamer 即为此实例化
+    class FunctionSink {
+    public:
+        explicit FunctionSink(const Config &config)
+            : on_video_(config.on_video_data), on_audio_(config.on_audio_data), on_log_(config.log_callback) {
+        }
+
+        bool acceptsVideo() const { return static_cast<bool>(on_video_); }
+        bool acceptsAudio() const { return static_cast<bool>(on_audio_); }
+        bool acceptsLog() const { return static_cast<bool>(on_log_); }
+
+        void onVideo(std::shared_ptr<AVFrame> frame, const int64_t pts) { on_video_(std::move(frame), pts); }
+        void onAudio(std::shared_ptr<AVFrame> frame, const int64_t pts) { on_audio_(std::move(frame), pts); }
+        void onLog(const LogLevel level, const char *message) { on_log_(level, message); }
+
+        // BasicAirplayStreamer 用它代替生成的跳板，库直接调用这里的 std::function
+        SinkHooks hooks() const {
+            SinkHooks hooks;
+            if (on_video_) hooks.video_function = &on_video_;
+            if (on_audio_) hooks.audio_function = &on_audio_;
+            if (on_log_) hooks.log_function = &on_log_;
+            return hooks;
+        }
+
+    private:
+        AVFrameCallback on_video_;
+        AVFrameCallback on_audio_;
+        std::function<void(LogLevel level, const char *)> on_log_;
+    };
+
+    // 回调接收者在编译期确定的前端。Sink 可以提供以下任意成员，没有的就不接收：
+    //   void onVideo(std::shared_ptr<AVFrame> frame, int64_t pts);
+    //   void onAudio(std::shared_ptr<AVFrame> frame, int64_t pts);
+    //   void onLog(LogLevel level, const char *message);
+    // 以及可选的 bool acceptsVideo() / acceptsAudio() / acceptsLog() const，在构造时决定是否启用。
+    // 每次调用经过一个普通函数指针进入 Sink，Sink 的成员函数在其中内联，没有 std::function 的类型擦除。
+    // 使用 Sink 时 Config 中对应的 std::function 不会被调用。
+    // FunctionSink 例外：库直接调用它保存的 std::function，每帧只有一次间接调用
+    template<typename Sink>
+    class BasicAirplayStreamer {
+    public:
+        // Sink 可以从 Config 构造时用 Config 构造，否则默认构造
+        explicit BasicAirplayStreamer(const Config &config)
+            requires std::is_constructible_v<Sink, const Config &> || std::is_default_constructible_v<Sink>
+            : sink_(makeSink(config)), core_(config, hooks(sink_)) {
+        }
+
+        BasicAirplayStreamer(const Config &config, Sink sink)
+            : sink_(std::move(sink)), core_(config, hooks(sink_)) {
+        }
+
+        BasicAirplayStreamer(const BasicAirplayStreamer &) = delete;
+
+        BasicAirplayStreamer &operator=(const BasicAirplayStreamer &) = delete;
+
+        Sink &sink() { return sink_; }
+        const Sink &sink() const { return sink_; }
+
+        void start() const { core_.start(); }
+
+        void stop() const { core_.stop(); }
+
+        bool isRunning() const { return core_.isRunning(); }
+
+        std::vector<SessionStats> sessionStats() const { return core_.sessionStats(); }
+
+        SubscriptionId subscribe(AVFrameCallback callback, SubscriberOptions options = {}) const {
+            return core_.subscribe(std::move(callback), std::move(options));
+        }
+
+        SubscriptionId subscribe(std::shared_ptr<FrameQueue> queue, std::string name = {}) const {
+            return core_.subscribe(std::move(queue), std::move(name));
+        }
+
+        SubscriptionId subscribe(std::shared_ptr<FrameStream> stream) const {
+            return core_.subscribe(std::move(stream));
+        }
+
+        void unsubscribe(const SubscriptionId id) const { core_.unsubscribe(id); }
+
+        std::vector<SubscriberStats> subscriberStats() const { return core_.subscriberStats(); }
+
+    private:
+        static Sink makeSink(const Config &config) {
+            if constexpr (std::is_constructible_v<Sink, const Config &>) {
+                return Sink(config);
+            } else {
+                return Sink();
+            }
+        }
+
+        static SinkHooks hooks(Sink &sink) {
+            if constexpr (std::is_same_v<Sink, FunctionSink>) {
+                return sink.hooks();
+            } else {
+                SinkHooks hooks;
+                hooks.sink = &sink;
+                if constexpr (requires(Sink &s, std::shared_ptr<AVFrame> f) { s.onVideo(std::move(f), int64_t{}); }) {
+                    bool accepts = true;
+                    if constexpr (requires(const Sink &s) { { s.acceptsVideo() } -> std::convertible_to<bool>; }) {
+                        accepts = sink.acceptsVideo();
+                    }
+                    if (accepts) {
+                        hooks.video = [](void *s, std::shared_ptr<AVFrame> &&frame, const int64_t pts) {
+                            static_cast<Sink *>(s)->onVideo(std::move(frame), pts);
+                        };
+                    }
+                }
+                if constexpr (requires(Sink &s, std::shared_ptr<AVFrame> f) { s.onAudio(std::move(f), int64_t{}); }) {
+                    bool accepts = true;
+                    if constexpr (requires(const Sink &s) { { s.acceptsAudio() } -> std::convertible_to<bool>; }) {
+                        accepts = sink.acceptsAudio();
+                    }
+                    if (accepts) {
+                        hooks.audio = [](void *s, std::shared_ptr<AVFrame> &&frame, const int64_t pts) {
+                            static_cast<Sink *>(s)->onAudio(std::move(frame), pts);
+                        };
+                    }
+                }
+                if constexpr (requires(Sink &s) { s.onLog(LogLevel::Info, static_cast<const char *>(nullptr)); }) {
+                    bool accepts = true;
+                    if constexpr (requires(const Sink &s) { { s.acceptsLog() } -> std::convertible_to<bool>; }) {
+                        accepts = sink.acceptsLog();
+                    }
+                    if (accepts) {
+                        hooks.log = [](void *s, const LogLevel level, const char *message) {
+                            static_cast<Sink *>(s)->onLog(level, message);
+                        };
+                    }
+                }
+                return hooks;
+            }
+        }
+
+        Sink sink_; // 必须在 core_ 之前构造、之后析构：core_ 的线程会调用它
+        StreamerCore core_;
+    };
+
+    using AirplayStreamer = BasicAirplayStreamer<FunctionSink>;
 } // namespace airplay_streamer
@@ -0,0 +1,83 @@
+// include/decoder_backend.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "airplay_streamer.hpp"
+
+struct AVBufferRef;
+struct AVCodecContext;
+struct AVFrame;
+
+namespace ender::airplay_streamer {
+    // 打开 / 重新配置解码器时的流参数和建议的线程设置
+    struct DecoderParams {
+        const uint8_t *avcc = nullptr; // avcC 记录，此后送入的包都是 AVCC 格式（4 字节长度前缀）
+        size_t avcc_size = 0;
+        int width = 0; // 编码分辨率
+        int height = 0;
+
+        // 按分辨率和正在解码的会话数分配的线程，Auto 表示单线程
+        int thread_count = 1;
+        DecoderThreadType thread_type = DecoderThreadType::Auto;
+
+        bool low_latency = false;           // 不要为重排多缓存帧
+        bool fast = false;                  // 允许不符合规范的加速
+        bool export_motion_vectors = false; // 在输出帧上附带 AV_FRAME_DATA_MOTION_VECTORS
+    };
+
+    // 降级和抽样要求后端跳过的工作，后端做不到的可以忽略
+    struct DecodeSkip {
+        bool loop_filter = false;   // 跳过去块滤波
+        bool non_reference = false; // 不输出非参考帧
+        bool non_key = false;       // 只输出关键帧
+
+        bool operator==(const DecodeSkip &other) const = default;
+    };
+
+    // 会话提供给后端的输出端，只在解码线程上使用
+    class DecoderOutput {
+    public:
+        // 按 frame 上已经填好的 width / height / format 从会话的帧池分配像素缓冲，失败返回负的 AVERROR
+        virtual int allocate(AVFrame *frame) = 0;
+
+        // 基于 libavcodec 的后端：让 ctx 通过 get_buffer2 从帧池分配，并按分辨率预留 count 块缓冲
+        virtual void attach(AVCodecContext *ctx) = 0;
+
+        virtual void reserve(AVCodecContext *ctx, int width, int height, int count) = 0;
+
+        // 交出一帧解码结果，时间戳取 frame->pts；frame 的引用被移走
+        virtual void emit(AVFrame *frame) = 0;
+
+    protected:
+        ~DecoderOutput() = default;
+    };
+
+    // 每个会话一个的视频解码后端，所有调用都在这个会话的解码线程上。
+    // 默认实现是 libavcodec 的 H.264 解码器，可以通过 Config::decoder_backend 换成别的实现
+    class DecoderBackend {
+    public:
+        virtual ~DecoderBackend() = default;
+
+        // 用于日志和 SessionStats::decoder_backend
+        virtual const char *name() const = 0;
+
+        // 收到第一个参数集时调用，失败时抛出 std::runtime_error
+        virtual void open(const DecoderParams &params, DecoderOutput &output) = 0;
+
+        // 参数集变化（旋转、分辨率变化）时调用；返回 false 表示不能原地切换，会话会换一个新后端重新 open
+        virtual bool reconfigure(const DecoderParams &params) = 0;
+
+        // 解码一个访问单元并通过 output 交出已经完成的帧；接管 buffer 的引用。
+        // 失败返回负的 AVERROR，会话只记录日志，继续送下一个包
+        virtual int decode(AVBufferRef *buffer, int size, int64_t pts) = 0;
+
+        // 丢弃内部缓存的帧，参数集保留
+        virtual void flush() = 0;
+
+        // 默认什么都不跳过
+        virtual void setSkip(const DecodeSkip & /*skip*/) {
+        }
+    };
+} // namespace airplay_streamer
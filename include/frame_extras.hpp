@@ -0,0 +1,71 @@
+// include/frame_extras.hpp
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct AVFrame;
+
+namespace ender::airplay_streamer {
+    // 按亮度 tile 比较得到的变化图，坐标以缩小前的帧（开启 ContentCrop 时为裁剪后）为准
+    struct TileMap {
+        int tile_size = 0; // 0 表示这一帧没有计算
+        int columns = 0;
+        int rows = 0;
+        std::vector<uint8_t> dirty; // columns * rows 个，行优先，1 表示与上一次交付的帧不同
+        int dirty_tiles = 0;
+        bool full = false; // 没有可比较的上一帧（第一帧、分辨率变化），所有 tile 都标为变化
+
+        bool computed() const { return tile_size > 0; }
+    };
+
+    // 亮度统计，按 Analytics 的步长隔行、隔列采样
+    struct FrameAnalytics {
+        bool computed = false;
+        std::array<uint32_t, 256> histogram{}; // 采样点的亮度直方图
+        uint32_t samples = 0;                  // 直方图中的采样点数
+        float mean = 0.0f;                     // 采样行的亮度均值 / 方差
+        float variance = 0.0f;
+        bool black = false;     // 几乎所有采样点都不超过 black_level
+        bool blank = false;     // 方差很小，整屏接近纯色（黑屏也算）
+        bool unchanged = false; // 采样行与上一帧完全相同
+    };
+
+    // 一个 16x16 宏块的运动，由解码器导出的各分区运动矢量按面积加权平均得到
+    struct MacroblockMotion {
+        int16_t dx = 0; // 1/4 像素：参考帧中对应位置减去当前位置（指向前向参考帧）
+        int16_t dy = 0;
+        bool inter = false; // false 表示帧内编码（或关键帧），没有运动矢量
+    };
+
+    // 整帧的宏块运动场，坐标以解码器输出的帧为准（不受 ContentCrop 影响）
+    struct MotionField {
+        int columns = 0; // 宏块列数 / 行数，0 表示这一帧没有导出
+        int rows = 0;
+        std::vector<MacroblockMotion> blocks; // columns * rows 个，行优先
+        int moving_blocks = 0;      // 运动矢量不为零的宏块数
+        float mean_magnitude = 0.0f; // 帧间宏块的平均运动幅度，像素
+
+        bool computed() const { return columns > 0; }
+    };
+
+    // 库在交付的帧上附加的额外结果，通过 AVFrame::opaque_ref 携带，随帧一起释放
+    struct FrameExtras {
+        // OutputLadder 各级缩小帧，顺序与 OutputLadder::divisors 相同
+        std::vector<std::shared_ptr<AVFrame>> ladder;
+
+        // DirtyTracking 开启时的变化图
+        TileMap tiles;
+
+        // Analytics 开启时的亮度统计
+        FrameAnalytics analytics;
+
+        // export_motion_vectors 开启时的运动场；原始的 AVMotionVector 仍保留在帧的 side data 里
+        MotionField motion;
+    };
+
+    // 取出帧上附加的 FrameExtras，没有时返回 nullptr；帧存活期间指针有效
+    const FrameExtras *frameExtras(const AVFrame *frame);
+} // namespace airplay_streamer
@@ -0,0 +1,66 @@
+// include/frame_queue.hpp
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+struct AVFrame;
+
+namespace ender::airplay_streamer {
+    // 订阅者队列满时的处理方式
+    enum class DropPolicy {
+        DropOldest, // 丢掉队列里最旧的帧，拿到的总是较新的画面（预览、分析）
+        DropNewest  // 丢掉新来的帧，已排队的帧按顺序交付
+    };
+
+    struct QueuedFrame {
+        std::shared_ptr<AVFrame> frame;
+        int64_t pts = 0;
+    };
+
+    // 由消费者自己拉取的有界帧队列，适合游戏循环、批量推理这类按自己节奏取帧的场景。
+    // 底层是多生产者/多消费者无锁环形队列：push / tryPop 不加锁，
+    // 只有 popFor 在队列为空、需要睡眠时才用到互斥量
+    class FrameQueue {
+    public:
+        FrameQueue(size_t capacity, DropPolicy drop_policy);
+
+        ~FrameQueue();
+
+        FrameQueue(const FrameQueue &) = delete;
+
+        FrameQueue &operator=(const FrameQueue &) = delete;
+
+        // 生产者一侧，库在解码 / delivery 线程上调用；队列满时按 drop_policy 丢帧，
+        // 帧被丢掉（DropNewest）或队列已关闭时返回 false
+        bool push(std::shared_ptr<AVFrame> frame, int64_t pts);
+
+        // 队列为空时立即返回 false
+        bool tryPop(QueuedFrame &out);
+
+        // 最多等待 timeout；超时或队列已关闭且取空时返回 false
+        bool popFor(QueuedFrame &out, std::chrono::microseconds timeout);
+
+        // 关闭后不再接收新帧，唤醒所有在 popFor 中等待的消费者；已排队的帧仍可取出
+        void close();
+
+        bool closed() const;
+
+        // 近似值
+        size_t size() const;
+
+        size_t capacity() const;
+
+        DropPolicy dropPolicy() const;
+
+        uint64_t framesPopped() const;
+
+        uint64_t framesDropped() const;
+
+    private:
+        class Impl;
+        std::unique_ptr<Impl> impl_;
+    };
+} // namespace airplay_streamer
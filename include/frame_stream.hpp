@@ -0,0 +1,95 @@
+// include/frame_stream.hpp
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "frame_queue.hpp"
+
+struct AVFrame;
+
+namespace ender::airplay_streamer {
+    // 恢复协程的执行器，例如把句柄投递到线程池或事件循环；
+    // 不设置时在推送帧的解码 / delivery 线程上直接恢复，此时协程不能阻塞
+    using CoroutineExecutor = std::function<void(std::coroutine_handle<> handle)>;
+
+    struct StreamedFrame {
+        std::shared_ptr<AVFrame> frame;
+        int64_t pts = 0;
+        uint64_t session_id = 0;
+    };
+
+    struct FrameStreamOptions {
+        std::string name; // 只用于日志和统计
+        size_t capacity = 4;
+        DropPolicy drop_policy = DropPolicy::DropOldest;
+        uint64_t session_id = 0; // 只接收这个会话的帧，会话结束时流随之关闭；0 表示所有会话
+        CoroutineExecutor executor;
+    };
+
+    // 供协程 co_await 的帧流，每个流同一时刻只能有一个协程在等待：
+    //   while (auto item = co_await stream->next()) { ... }
+    // 流关闭并取空后 next() 得到 nullopt。等待中的协程不占线程，成千上万个流只需要执行器里的几个线程
+    class FrameStream {
+    public:
+        explicit FrameStream(FrameStreamOptions options = {});
+
+        ~FrameStream();
+
+        FrameStream(const FrameStream &) = delete;
+
+        FrameStream &operator=(const FrameStream &) = delete;
+
+        class NextAwaiter {
+        public:
+            bool await_ready() { return stream_.take(result_); }
+
+            bool await_suspend(const std::coroutine_handle<> handle) { return stream_.suspend(handle, result_); }
+
+            std::optional<StreamedFrame> await_resume() { return std::move(result_); }
+
+        private:
+            friend class FrameStream;
+
+            explicit NextAwaiter(FrameStream &stream) : stream_(stream) {
+            }
+
+            FrameStream &stream_;
+            std::optional<StreamedFrame> result_;
+        };
+
+        NextAwaiter next() { return NextAwaiter(*this); }
+
+        // 生产者一侧，库在解码 / delivery 线程上调用；有协程在等待时直接交给它并通过执行器恢复，
+        // 否则入队，队列满时按 drop_policy 丢帧
+        bool push(std::shared_ptr<AVFrame> frame, int64_t pts, uint64_t session_id);
+
+        // 不再接收新帧并恢复等待中的协程；已排队的帧仍可取出
+        void close();
+
+        bool closed() const;
+
+        const FrameStreamOptions &options() const;
+
+        size_t size() const;
+
+        uint64_t framesResumed() const; // 交给协程的帧
+
+        uint64_t framesDropped() const;
+
+    private:
+        // 有帧或已关闭时填好 out（关闭且为空时为 nullopt）并返回 true
+        bool take(std::optional<StreamedFrame> &out);
+
+        // 返回 false 表示在加锁检查时已经拿到结果，不需要挂起
+        bool suspend(std::coroutine_handle<> handle, std::optional<StreamedFrame> &out);
+
+        class Impl;
+        std::unique_ptr<Impl> impl_;
+    };
+} // namespace airplay_streamer
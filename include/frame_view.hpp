@@ -0,0 +1,49 @@
+// include/frame_view.hpp
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "video_frame.hpp"
+
+struct AVFrame;
+
+namespace ender::airplay_streamer {
+    // 解码帧的借用视图：平面指针、步长、格式和尺寸，使用时不需要 FFmpeg 头文件。
+    // 回调期间有效，构造不分配内存也不碰引用计数；需要在回调之后继续使用时调用 retain()
+    class FrameView {
+    public:
+        FrameView() = default;
+
+        const uint8_t *data[4] = {};
+        int stride[4] = {};
+        int width = 0;
+        int height = 0;
+        PixelFormat format = PixelFormat::Count; // Count 表示 PixelFormat 之外的格式，见 native_format
+        int native_format = -1;                  // AVPixelFormat 的值
+        bool full_range = false;
+        int64_t pts = 0;
+        uint64_t session_id = 0;
+
+        // 底层帧，与视图的有效期相同
+        const AVFrame *avFrame() const { return frame_; }
+
+        // 升级为持有引用的视图：帧外壳来自会话的帧池，像素不复制；失败返回 nullptr
+        std::shared_ptr<const FrameView> retain() const;
+
+    private:
+        friend struct FrameViewAccess;
+
+        const AVFrame *frame_ = nullptr;
+
+        // 借用视图用它从帧池取得新引用
+        std::shared_ptr<AVFrame> (*share_)(void *context, const AVFrame *frame) = nullptr;
+        void *share_context_ = nullptr;
+
+        // retain() 得到的视图自己持有帧
+        std::shared_ptr<AVFrame> owned_;
+    };
+
+    using FrameViewCallback = std::function<void(const FrameView &view)>;
+} // namespace airplay_streamer
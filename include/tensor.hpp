@@ -0,0 +1,64 @@
+// include/tensor.hpp
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace ender::airplay_streamer {
+    enum class TensorLayout {
+        Nchw, // 三个通道平面依次排列
+        Nhwc  // 逐像素交错
+    };
+
+    enum class TensorType {
+        Float32, // (像素 / 255 - mean) / std
+        Uint8    // 原始 0..255 像素值，不做归一化
+    };
+
+    // 模型输入的形状和预处理参数；width / height 为 0 时不输出张量
+    struct TensorSpec {
+        int width = 0;
+        int height = 0;
+        TensorLayout layout = TensorLayout::Nchw;
+        TensorType type = TensorType::Float32;
+        bool bgr = false;      // 通道顺序，默认 RGB
+        bool letterbox = true; // 保持宽高比缩放并居中填充；false 时直接拉伸
+        uint8_t pad_value = 0; // 填充区域的像素值（归一化前）
+
+        // 按输出通道顺序，作用在 0..1 的像素值上，只对 Float32 生效
+        std::array<float, 3> mean = {0.0f, 0.0f, 0.0f};
+        std::array<float, 3> std = {1.0f, 1.0f, 1.0f};
+    };
+
+    // 一帧转换好的张量，batch 固定为 1
+    struct Tensor {
+        uint64_t session_id = 0;
+        int64_t pts = 0; // 与 on_video_data 的时间戳相同
+
+        void *data = nullptr;
+        size_t size = 0; // 字节数
+        int width = 0;
+        int height = 0;
+        int channels = 3;
+        TensorLayout layout = TensorLayout::Nchw;
+        TensorType type = TensorType::Float32;
+
+        // 画面在张量中的位置：原图坐标 = (张量坐标 - pad) / scale
+        int pad_left = 0;
+        int pad_top = 0;
+        int content_width = 0;
+        int content_height = 0;
+        float scale_x = 1.0f;
+        float scale_y = 1.0f;
+    };
+
+    // 张量在库内部的池中时，最后一个引用释放后缓冲回到池里
+    using TensorCallback = std::function<void(std::shared_ptr<const Tensor> tensor)>;
+
+    // 调用方提供输出缓冲：返回至少 bytes 字节的内存（建议 64 字节对齐），生命周期由调用方管理；
+    // 返回 nullptr 时这一帧改用库内部的池
+    using TensorAllocator = std::function<void *(size_t bytes, int64_t pts)>;
+} // namespace airplay_streamer
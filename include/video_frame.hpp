@@ -0,0 +1,77 @@
+// include/video_frame.hpp
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "frame_extras.hpp"
+
+struct AVFrame;
+
+namespace ender::airplay_streamer {
+    // VideoFrame::as 支持的目标像素格式
+    enum class PixelFormat {
+        Yuv420p,
+        Nv12,
+        Bgra,
+        Rgba,
+        Rgb24,
+        Bgr24,
+        Gray8,
+        Count
+    };
+
+    // 解码帧的包装：按需转换像素格式，第一次访问时转换，之后所有持有者共享同一份结果。
+    // 转换用的 SwsContext 按（尺寸，源格式，目标格式）全局缓存；
+    // yuv420p -> BGRA / NV12 走 SIMD 快速路径
+    class VideoFrame {
+    public:
+        static std::shared_ptr<VideoFrame> create(std::shared_ptr<AVFrame> frame, int64_t pts);
+
+        VideoFrame(std::shared_ptr<AVFrame> frame, int64_t pts);
+
+        ~VideoFrame();
+
+        VideoFrame(const VideoFrame &) = delete;
+
+        VideoFrame &operator=(const VideoFrame &) = delete;
+
+        // 解码器输出的原始帧
+        const std::shared_ptr<AVFrame> &frame() const { return frame_; }
+
+        int64_t pts() const { return pts_; }
+
+        // 库附加在帧上的额外结果（多级缩小帧等），没有时返回 nullptr
+        const FrameExtras *extras() const { return frameExtras(frame_.get()); }
+
+        int width() const;
+
+        int height() const;
+
+        // 返回 format 格式的帧，源格式相同时直接返回原始帧；失败返回 nullptr。
+        // 可以在多个线程上同时调用，同一格式只转换一次（失败也只尝试一次），不同格式互不等待
+        std::shared_ptr<AVFrame> as(PixelFormat format);
+
+        // format 是否已经转换过（或就是源格式）
+        bool has(PixelFormat format) const;
+
+    private:
+        std::shared_ptr<AVFrame> frame_;
+        int64_t pts_ = 0;
+
+        // 每个目标格式一个槽位，各自的 once_flag 保证只转换一次
+        struct Slot {
+            std::once_flag once;
+            std::atomic<bool> done{false};
+            std::shared_ptr<AVFrame> frame; // done 之后只读；转换失败时保持为空
+        };
+
+        std::array<Slot, static_cast<size_t>(PixelFormat::Count)> converted_;
+    };
+
+    using VideoFrameCallback = std::function<void(std::shared_ptr<VideoFrame> frame)>;
+} // namespace airplay_streamer
@@ -45,6 +45,9 @@ struct raop_s {
     dnssd_t *dnssd;
 
     unsigned short port;
+
+    /* Tune mirror sockets for delay rather than throughput */
+    int low_latency;
 };
 
 struct raop_conn_s {
@@ -61,6 +64,8 @@ struct raop_conn_s {
     unsigned char *remote;
     int remotelen;
 
+    /* Opaque per-connection pointer returned by the conn_init callback */
+    void *conn_cls;
 };
 typedef struct raop_conn_s raop_conn_t;
 
@@ -126,7 +131,7 @@ conn_init(void *opaque, unsigned char *local, int locallen, unsigned char *remot
     conn->remotelen = remotelen;
 
     if (raop->callbacks.conn_init) {
-        raop->callbacks.conn_init(raop->callbacks.cls);
+        conn->conn_cls = raop->callbacks.conn_init(raop->callbacks.cls);
     }
 
     return conn;
@@ -224,13 +229,6 @@ conn_destroy(void *ptr) {
 
     logger_log(conn->raop->logger, LOGGER_INFO, "Destroying connection");
 
-    if (conn->raop->callbacks.conn_destroy) {
-        conn->raop->callbacks.conn_destroy(conn->raop->callbacks.cls);
-    }
-
-    if (conn->raop_ntp) {
-        raop_ntp_destroy(conn->raop_ntp);
-    }
     if (conn->raop_rtp) {
         /* This is done in case TEARDOWN was not called */
         raop_rtp_destroy(conn->raop_rtp);
@@ -239,8 +237,18 @@ conn_destroy(void *ptr) {
         /* This is done in case TEARDOWN was not called */
         raop_rtp_mirror_destroy(conn->raop_rtp_mirror);
     }
+    /* The rtp threads use the ntp clock, so it goes last */
+    if (conn->raop_ntp) {
+        raop_ntp_destroy(conn->raop_ntp);
+    }
 
-    conn->raop->callbacks.video_flush(conn->raop->callbacks.cls);
+    /* The mirror thread is joined now, so no video_process call can race with these */
+    if (conn->raop->callbacks.video_flush) {
+        conn->raop->callbacks.video_flush(conn->raop->callbacks.cls, conn->conn_cls);
+    }
+    if (conn->raop->callbacks.conn_destroy) {
+        conn->raop->callbacks.conn_destroy(conn->raop->callbacks.cls, conn->conn_cls);
+    }
 
     free(conn->local);
     free(conn->remote);
@@ -340,6 +348,12 @@ raop_set_port(raop_t *raop, unsigned short port) {
     raop->port = port;
 }
 
+void
+raop_set_low_latency(raop_t *raop, int low_latency) {
+    assert(raop);
+    raop->low_latency = low_latency;
+}
+
 unsigned short
 raop_get_port(raop_t *raop) {
     assert(raop);
@@ -35,13 +35,19 @@ struct raop_callbacks_s {
     void* cls;
 
     void  (*audio_process)(void *cls, raop_ntp_t *ntp, aac_decode_struct *data);
-    void  (*video_process)(void *cls, raop_ntp_t *ntp, h264_decode_struct *data);
+    void  (*video_process)(void *cls, void *conn_cls, raop_ntp_t *ntp, h264_decode_struct *data);
 
     /* Optional but recommended callback functions */
-    void  (*conn_init)(void *cls);
-    void  (*conn_destroy)(void *cls);
+    /* conn_init may return a per-connection pointer, which is handed back as conn_cls */
+    void* (*conn_init)(void *cls);
+    void  (*conn_destroy)(void *cls, void *conn_cls);
     void  (*audio_flush)(void *cls);
-    void  (*video_flush)(void *cls);
+    void  (*video_flush)(void *cls, void *conn_cls);
+    /* Called from the SETUP handler once the mirror receiver is created, before any video arrives */
+    void  (*video_setup)(void *cls, void *conn_cls);
+    /* Returns a buffer of at least size bytes for the next decrypted video frame,
+     * which is then handed to video_process. NULL falls back to an internal buffer. */
+    unsigned char* (*video_get_buffer)(void *cls, void *conn_cls, int size);
     void  (*audio_set_volume)(void *cls, float volume);
     void  (*audio_set_metadata)(void *cls, const void *buffer, int buflen);
     void  (*audio_set_coverart)(void *cls, const void *buffer, int buflen);
@@ -55,6 +61,7 @@ RAOP_API raop_t *raop_init(int max_clients, raop_callbacks_t *callbacks);
 RAOP_API void raop_set_log_level(raop_t *raop, int level);
 RAOP_API void raop_set_log_callback(raop_t *raop, raop_log_callback_t callback, void *cls);
 RAOP_API void raop_set_port(raop_t *raop, unsigned short port);
+RAOP_API void raop_set_low_latency(raop_t *raop, int low_latency);
 RAOP_API unsigned short raop_get_port(raop_t *raop);
 RAOP_API void *raop_get_callback_cls(raop_t *raop);
 RAOP_API int raop_start(raop_t *raop, unsigned short *port);
@@ -377,7 +377,13 @@ raop_handler_setup(raop_conn_t *conn,
         raop_ntp_start(conn->raop_ntp, &timing_lport);
 
         conn->raop_rtp = raop_rtp_init(conn->raop->logger, &conn->raop->callbacks, conn->raop_ntp, conn->remote, conn->remotelen, aeskey, aesiv, ecdh_secret);
-        conn->raop_rtp_mirror = raop_rtp_mirror_init(conn->raop->logger, &conn->raop->callbacks, conn->raop_ntp, conn->remote, conn->remotelen, aeskey, ecdh_secret);
+        conn->raop_rtp_mirror = raop_rtp_mirror_init(conn->raop->logger, &conn->raop->callbacks, conn->conn_cls, conn->raop_ntp, conn->remote, conn->remotelen, aeskey, ecdh_secret);
+        if (conn->raop_rtp_mirror) {
+            raop_rtp_mirror_set_low_latency(conn->raop_rtp_mirror, conn->raop->low_latency);
+            if (conn->raop->callbacks.video_setup) {
+                conn->raop->callbacks.video_setup(conn->raop->callbacks.cls, conn->conn_cls);
+            }
+        }
 
         plist_t res_event_port_node = plist_new_uint(conn->raop->port);
         plist_t res_timing_port_node = plist_new_uint(timing_lport);
@@ -48,23 +48,10 @@
 #include "stream.h"
 
 
-struct h264codec_s {
-    unsigned char compatibility;
-    short pps_size;
-    short sps_size;
-    unsigned char level;
-    unsigned char number_of_pps;
-    unsigned char* picture_parameter_set;
-    unsigned char profile_high;
-    unsigned char reserved_3_and_sps;
-    unsigned char reserved_6_and_nal;
-    unsigned char* sequence_parameter_set;
-    unsigned char version;
-};
-
 struct raop_rtp_mirror_s {
     logger_t *logger;
     raop_callbacks_t callbacks;
+    void *conn_cls;
     raop_ntp_t *ntp;
 
     /* Buffer to handle all resends */
@@ -87,8 +74,34 @@ struct raop_rtp_mirror_s {
     int mirror_data_sock;
 
     unsigned short mirror_data_lport;
+
+    /* Set before the thread starts, read-only afterwards */
+    int low_latency;
+
+    /* Reused across frames, only touched by the mirror thread */
+    unsigned char *payload_buf;
+    int payload_buf_size;
+    unsigned char *decrypted_buf;
+    int decrypted_buf_size;
 };
 
+static unsigned char *
+raop_rtp_mirror_reserve(unsigned char **buf, int *buf_size, int size)
+{
+    if (size < 1) {
+        size = 1;
+    }
+    if (size > *buf_size) {
+        unsigned char *grown = realloc(*buf, size);
+        if (!grown) {
+            return NULL;
+        }
+        *buf = grown;
+        *buf_size = size;
+    }
+    return *buf;
+}
+
 static int
 raop_rtp_parse_remote(raop_rtp_mirror_t *raop_rtp_mirror, const unsigned char *remote, int remotelen)
 {
@@ -116,8 +129,27 @@ raop_rtp_parse_remote(raop_rtp_mirror_t *raop_rtp_mirror, const unsigned char *r
     return 0;
 }
 
+/* Default mode polls the run flag every 5 ms; low latency mode blocks in select/recv
+ * and only wakes up this often to notice a stop request */
+#define MIRROR_POLL_USEC 5000
+#define MIRROR_POLL_USEC_LOW_LATENCY 100000
+/* Room for a few keyframes so the sender never stalls on a full window */
+#define MIRROR_RCVBUF_LOW_LATENCY (4 * 1024 * 1024)
+
+static void
+raop_rtp_mirror_quickack(int fd)
+{
+#ifdef TCP_QUICKACK
+    /* Not sticky on Linux, has to be re-armed after each read */
+    int option = 1;
+    setsockopt(fd, SOL_TCP, TCP_QUICKACK, &option, sizeof(option));
+#else
+    (void) fd;
+#endif
+}
+
 #define NO_FLUSH (-42)
-raop_rtp_mirror_t *raop_rtp_mirror_init(logger_t *logger, raop_callbacks_t *callbacks, raop_ntp_t *ntp,
+raop_rtp_mirror_t *raop_rtp_mirror_init(logger_t *logger, raop_callbacks_t *callbacks, void *conn_cls, raop_ntp_t *ntp,
                                         const unsigned char *remote, int remotelen,
                                         const unsigned char *aeskey, const unsigned char *ecdh_secret)
 {
@@ -131,6 +163,7 @@ raop_rtp_mirror_t *raop_rtp_mirror_init(logger_t *logger, raop_callbacks_t *call
         return NULL;
     }
     raop_rtp_mirror->logger = logger;
+    raop_rtp_mirror->conn_cls = conn_cls;
     raop_rtp_mirror->ntp = ntp;
 
     memcpy(&raop_rtp_mirror->callbacks, callbacks, sizeof(raop_callbacks_t));
@@ -151,6 +184,13 @@ raop_rtp_mirror_t *raop_rtp_mirror_init(logger_t *logger, raop_callbacks_t *call
     return raop_rtp_mirror;
 }
 
+void
+raop_rtp_mirror_set_low_latency(raop_rtp_mirror_t *raop_rtp_mirror, int low_latency)
+{
+    assert(raop_rtp_mirror);
+    raop_rtp_mirror->low_latency = low_latency;
+}
+
 void
 raop_rtp_init_mirror_aes(raop_rtp_mirror_t *raop_rtp_mirror, uint64_t streamConnectionID)
 {
@@ -174,6 +214,7 @@ raop_rtp_mirror_thread(void *arg)
     memset(packet, 0 , 128);
     unsigned char* payload = NULL;
     unsigned int readstart = 0;
+    const int poll_usec = raop_rtp_mirror->low_latency ? MIRROR_POLL_USEC_LOW_LATENCY : MIRROR_POLL_USEC;
 
 #ifdef DUMP_H264
     // C decrypted
@@ -194,9 +235,9 @@ raop_rtp_mirror_thread(void *arg)
         }
         MUTEX_UNLOCK(raop_rtp_mirror->run_mutex);
 
-        /* Set timeout value to 5ms */
+        /* Wake up periodically to check the run flag */
         tv.tv_sec = 0;
-        tv.tv_usec = 5000;
+        tv.tv_usec = poll_usec;
 
         /* Get the correct nfds value and set rfds */
         FD_ZERO(&rfds);
@@ -231,7 +272,7 @@ raop_rtp_mirror_thread(void *arg)
             // We're calling recv for a certain amount of data, so we need a timeout
             struct timeval tv;
             tv.tv_sec = 0;
-            tv.tv_usec = 5000;
+            tv.tv_usec = poll_usec;
             if (setsockopt(stream_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) {
                 logger_log(raop_rtp_mirror->logger, LOGGER_ERR, "raop_rtp_mirror could not set stream socket timeout %d %s", errno, strerror(errno));
                 break;
@@ -253,6 +294,13 @@ raop_rtp_mirror_thread(void *arg)
             if (setsockopt(stream_fd, SOL_TCP, TCP_KEEPCNT, &option, sizeof(option)) < 0) {
                 logger_log(raop_rtp_mirror->logger, LOGGER_WARNING, "raop_rtp_mirror could not set stream socket keepalive probes %d %s", errno, strerror(errno));
             }
+            if (raop_rtp_mirror->low_latency) {
+                option = MIRROR_RCVBUF_LOW_LATENCY;
+                if (setsockopt(stream_fd, SOL_SOCKET, SO_RCVBUF, &option, sizeof(option)) < 0) {
+                    logger_log(raop_rtp_mirror->logger, LOGGER_WARNING, "raop_rtp_mirror could not set stream socket receive buffer %d %s", errno, strerror(errno));
+                }
+                raop_rtp_mirror_quickack(stream_fd);
+            }
             readstart = 0;
         }
 
@@ -281,7 +329,11 @@ raop_rtp_mirror_thread(void *arg)
             unsigned short payload_option = byteutils_get_short(packet, 6);
 
             if (payload == NULL) {
-                payload = malloc(payload_size);
+                payload = raop_rtp_mirror_reserve(&raop_rtp_mirror->payload_buf, &raop_rtp_mirror->payload_buf_size, payload_size);
+                if (payload == NULL) {
+                    logger_log(raop_rtp_mirror->logger, LOGGER_ERR, "raop_rtp_mirror could not allocate %d bytes for payload", payload_size);
+                    break;
+                }
                 readstart = 0;
             }
 
@@ -321,48 +373,38 @@ raop_rtp_mirror_thread(void *arg)
                 fwrite(&readstart, sizeof(readstart), 1, file_len);
 #endif
 
-                // Decrypt data
-                unsigned char* payload_decrypted = malloc(payload_size);
-                mirror_buffer_decrypt(raop_rtp_mirror->buffer, payload, payload_decrypted, payload_size);
-
-                int nalu_type = payload[4] & 0x1f;
-                int nalu_size = 0;
-                int nalus_count = 0;
-
-                // It seems the AirPlay protocol prepends NALs with their size, which we're replacing with the 4-byte
-                // start code for the NAL Byte-Stream Format.
-                while (nalu_size < payload_size) {
-                    int nc_len = (payload_decrypted[nalu_size + 0] << 24) | (payload_decrypted[nalu_size + 1] << 16) |
-                                 (payload_decrypted[nalu_size + 2] << 8) | (payload_decrypted[nalu_size + 3]);
-                    assert(nc_len > 0);
-
-                    payload_decrypted[nalu_size + 0] = 0;
-                    payload_decrypted[nalu_size + 1] = 0;
-                    payload_decrypted[nalu_size + 2] = 0;
-                    payload_decrypted[nalu_size + 3] = 1;
-                    nalu_size += nc_len + 4;
-                    nalus_count++;
+                // Decrypt data, preferably straight into the consumer's buffer
+                unsigned char* payload_decrypted = NULL;
+                if (raop_rtp_mirror->callbacks.video_get_buffer) {
+                    payload_decrypted = raop_rtp_mirror->callbacks.video_get_buffer(raop_rtp_mirror->callbacks.cls, raop_rtp_mirror->conn_cls, payload_size);
+                }
+                if (payload_decrypted == NULL) {
+                    payload_decrypted = raop_rtp_mirror_reserve(&raop_rtp_mirror->decrypted_buf, &raop_rtp_mirror->decrypted_buf_size, payload_size);
+                }
+                if (payload_decrypted == NULL) {
+                    logger_log(raop_rtp_mirror->logger, LOGGER_ERR, "raop_rtp_mirror could not allocate %d bytes for decryption", payload_size);
+                    break;
                 }
+                mirror_buffer_decrypt(raop_rtp_mirror->buffer, payload, payload_decrypted, payload_size);
 
-                // logger_log(raop_rtp_mirror->logger, LOGGER_DEBUG, "nalutype = %d", nalu_type);
-                // logger_log(raop_rtp_mirror->logger, LOGGER_DEBUG, "nalu_size = %d, payloadsize = %d nalus_count = %d",
-                //        nalu_size, payload_size, nalus_count);
+                // The AirPlay protocol prepends each NAL with its 4-byte big-endian size (AVCC framing).
+                // The data is handed on as-is; the consumer converts to the byte-stream format if it needs it.
 
 #ifdef DUMP_H264
                 fwrite(payload_decrypted, payload_size, 1, file);
 #endif
 
                 h264_decode_struct h264_data;
+                memset(&h264_data, 0, sizeof(h264_data));
                 h264_data.data_len = payload_size;
                 h264_data.data = payload_decrypted;
                 h264_data.frame_type = 1;
                 h264_data.pts = ntp_timestamp;
 
-                raop_rtp_mirror->callbacks.video_process(raop_rtp_mirror->callbacks.cls, raop_rtp_mirror->ntp, &h264_data);
-                free(payload_decrypted);
+                raop_rtp_mirror->callbacks.video_process(raop_rtp_mirror->callbacks.cls, raop_rtp_mirror->conn_cls, raop_rtp_mirror->ntp, &h264_data);
 
             } else if ((payload_type & 255) == 1) {
-                // The information in the payload contains an SPS and a PPS NAL
+                // The payload is an (unencrypted) avcC record carrying the SPS and PPS
 
                 float width_source = byteutils_get_float(packet, 40);
                 float height_source = byteutils_get_float(packet, 44);
@@ -371,68 +413,35 @@ raop_rtp_mirror_thread(void *arg)
                 logger_log(raop_rtp_mirror->logger, LOGGER_DEBUG, "raop_rtp_mirror width_source = %f height_source = %f width = %f height = %f",
                            width_source, height_source, width, height);
 
-                // The sps_pps is not encrypted
-                h264codec_t h264;
-                h264.version = payload[0];
-                h264.profile_high = payload[1];
-                h264.compatibility = payload[2];
-                h264.level = payload[3];
-                h264.reserved_6_and_nal = payload[4];
-                h264.reserved_3_and_sps = payload[5];
-                h264.sps_size = (short) (((payload[6] & 255) << 8) + (payload[7] & 255));
-                logger_log(raop_rtp_mirror->logger, LOGGER_DEBUG, "raop_rtp_mirror sps size = %d", h264.sps_size);
-                h264.sequence_parameter_set = malloc(h264.sps_size);
-                memcpy(h264.sequence_parameter_set, payload + 8, h264.sps_size);
-                h264.number_of_pps = payload[h264.sps_size + 8];
-                h264.pps_size = (short) (((payload[h264.sps_size + 9] & 2040) + payload[h264.sps_size + 10]) & 255);
-                h264.picture_parameter_set = malloc(h264.pps_size);
-                logger_log(raop_rtp_mirror->logger, LOGGER_DEBUG, "raop_rtp_mirror pps size = %d", h264.pps_size);
-                memcpy(h264.picture_parameter_set, payload + h264.sps_size + 11, h264.pps_size);
-
-                if (h264.sps_size + h264.pps_size < 102400) {
-                    // Copy the sps and pps into a buffer to hand to the decoder
-                    int sps_pps_len = (h264.sps_size + h264.pps_size) + 8;
-                    // 使用动态内存分配代替变长数组
-                    unsigned char* sps_pps = (unsigned char*)malloc(sps_pps_len);
-                    if (!sps_pps) {
-                        logger_log(raop_rtp_mirror->logger, LOGGER_ERR, "Failed to allocate memory for SPS/PPS");
-                        free(h264.sequence_parameter_set);
-                        free(h264.picture_parameter_set);
-                        free(payload);
-                        payload = NULL;
-                        continue;
-                    }
-                    sps_pps[0] = 0;
-                    sps_pps[1] = 0;
-                    sps_pps[2] = 0;
-                    sps_pps[3] = 1;
-                    memcpy(sps_pps + 4, h264.sequence_parameter_set, h264.sps_size);
-                    sps_pps[h264.sps_size + 4] = 0;
-                    sps_pps[h264.sps_size + 5] = 0;
-                    sps_pps[h264.sps_size + 6] = 0;
-                    sps_pps[h264.sps_size + 7] = 1;
-                    memcpy(sps_pps + h264.sps_size + 8, h264.picture_parameter_set, h264.pps_size);
+                if (payload_size >= 8) {
+                    short sps_size = (short) (((payload[6] & 255) << 8) + (payload[7] & 255));
+                    logger_log(raop_rtp_mirror->logger, LOGGER_DEBUG, "raop_rtp_mirror avcC size = %d, sps size = %d", payload_size, sps_size);
 
 #ifdef DUMP_H264
-                    fwrite(sps_pps, sps_pps_len, 1, file);
+                    fwrite(payload, payload_size, 1, file);
 #endif
 
                     h264_decode_struct h264_data;
-                    h264_data.data_len = sps_pps_len;
-                    h264_data.data = sps_pps;
+                    memset(&h264_data, 0, sizeof(h264_data));
+                    h264_data.data_len = payload_size;
+                    h264_data.data = payload;
                     h264_data.frame_type = 0;
                     h264_data.pts = 0;
-                    raop_rtp_mirror->callbacks.video_process(raop_rtp_mirror->callbacks.cls, raop_rtp_mirror->ntp, &h264_data);
-                    free(sps_pps);
+                    h264_data.width = (int) width;
+                    h264_data.height = (int) height;
+                    h264_data.source_width = (int) width_source;
+                    h264_data.source_height = (int) height_source;
+                    raop_rtp_mirror->callbacks.video_process(raop_rtp_mirror->callbacks.cls, raop_rtp_mirror->conn_cls, raop_rtp_mirror->ntp, &h264_data);
                 }
-                free(h264.picture_parameter_set);
-                free(h264.sequence_parameter_set);
             }
 
-            free(payload);
             payload = NULL;
             memset(packet, 0, 128);
             readstart = 0;
+
+            if (raop_rtp_mirror->low_latency) {
+                raop_rtp_mirror_quickack(stream_fd);
+            }
         }
     }
 
@@ -522,6 +531,8 @@ void raop_rtp_mirror_destroy(raop_rtp_mirror_t *raop_rtp_mirror) {
         raop_rtp_mirror_stop(raop_rtp_mirror);
         MUTEX_DESTROY(raop_rtp_mirror->run_mutex);
         mirror_buffer_destroy(raop_rtp_mirror->buffer);
+        free(raop_rtp_mirror->payload_buf);
+        free(raop_rtp_mirror->decrypted_buf);
         free(raop_rtp_mirror);
     }
 }
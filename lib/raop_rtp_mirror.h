@@ -21,12 +21,12 @@
 #include "raop_ntp.h"
 
 typedef struct raop_rtp_mirror_s raop_rtp_mirror_t;
-typedef struct h264codec_s h264codec_t;
 
-raop_rtp_mirror_t *raop_rtp_mirror_init(logger_t *logger, raop_callbacks_t *callbacks, raop_ntp_t *ntp,
+raop_rtp_mirror_t *raop_rtp_mirror_init(logger_t *logger, raop_callbacks_t *callbacks, void *conn_cls, raop_ntp_t *ntp,
                                         const unsigned char *remote, int remotelen,
                                         const unsigned char *aeskey, const unsigned char *ecdh_secret);
 void raop_rtp_init_mirror_aes(raop_rtp_mirror_t *raop_rtp_mirror, uint64_t streamConnectionID);
+void raop_rtp_mirror_set_low_latency(raop_rtp_mirror_t *raop_rtp_mirror, int low_latency);
 void raop_rtp_start_mirror(raop_rtp_mirror_t *raop_rtp_mirror, int use_udp, unsigned short *mirror_data_lport);
 
 static int raop_rtp_init_mirror_sockets(raop_rtp_mirror_t *raop_rtp_mirror, int use_ipv6);
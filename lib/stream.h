@@ -17,6 +17,11 @@
 
 #include <stdint.h>
 
+/*
+ * frame_type 0: data is the stream's avcC record (SPS/PPS), width/height is the encoded size,
+ *               source_width/source_height the sender's screen size in its current orientation
+ * frame_type 1: data is one access unit, NALs prefixed with their 4-byte big-endian size
+ */
 typedef struct {
     int n_gop_index;
     int frame_type;
@@ -25,6 +30,10 @@ typedef struct {
     int data_len;
     unsigned int n_time_stamp;
     uint64_t pts;
+    int width;
+    int height;
+    int source_width;
+    int source_height;
 } h264_decode_struct;
 
 typedef struct {
@@ -1,107 +1,138 @@
 // src/airplay_streamer.cpp
 
 #include <airplay_streamer.hpp>
+#include "streamer_context.hpp"
+#include "video_session.hpp"
 
 extern "C" {
 #include "raop.h"
 #include "dnssd.h"
 }
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <cstring>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
-#include <libswscale/swscale.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/frame.h>
 }
 
 namespace ender::airplay_streamer {
-    class AirplayStreamer::Impl {
+    class StreamerCore::Impl {
     public:
+        explicit Impl(const SinkHooks hooks) : context(config, hooks) {
+        }
+
         Config config;
+        StreamerContext context;
 
         bool running = false;
         raop_t *raop = nullptr;
         dnssd_t *dnssd = nullptr;
 
-        AVCodecContext *video_decoder = nullptr;
-        SwsContext *sws_context = nullptr;
+        // 每个连接一个 VideoSession，由 conn_init/conn_destroy 管理生命周期
+        std::mutex sessions_mutex;
+        std::vector<std::unique_ptr<VideoSession> > sessions;
+        std::atomic<uint64_t> next_session_id{1};
+
+        VideoSession *createSession() {
+            VideoSession *created;
+            try {
+                auto session = std::make_unique<VideoSession>(next_session_id++, context);
+                std::lock_guard lock(sessions_mutex);
+                created = sessions.emplace_back(std::move(session)).get();
+            } catch (const std::exception &e) {
+                // 异常不能穿过 C 回调，记录后让这个连接不出画面
+                logError(e.what());
+                return nullptr;
+            }
+            // conn_init 返回之前 mirror 线程还没启动，回调里订阅的帧流不会错过任何帧
+            notifySession(config.on_session_started, created->id());
+            return created;
+        }
 
-        void initCodec() {
-            const AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_H264);
-            if (!codec) {
-                throw std::runtime_error("Cannot find H.264 decoder.");
+        void destroySession(VideoSession *session) {
+            std::unique_ptr<VideoSession> owned;
+            {
+                std::lock_guard lock(sessions_mutex);
+                const auto it = std::find_if(sessions.begin(), sessions.end(),
+                                             [session](const auto &s) { return s.get() == session; });
+                if (it == sessions.end()) return;
+                owned = std::move(*it);
+                sessions.erase(it);
             }
+            // 在锁外释放解码器
+            const uint64_t id = owned->id();
+            owned.reset();
+            notifySession(config.on_session_ended, id);
+        }
 
-            video_decoder = avcodec_alloc_context3(codec);
-            if (!video_decoder) {
-                throw std::runtime_error("Failed to allocate video decoder context.");
+        void notifySession(const SessionCallback &callback, const uint64_t id) const {
+            if (!callback) return;
+            try {
+                callback(id);
+            } catch (const std::exception &e) {
+                logError(e.what());
             }
+        }
 
-            if (avcodec_open2(video_decoder, codec, nullptr) < 0) {
-                throw std::runtime_error("Failed to open H.264 decoder.");
+        void logError(const char *message) const {
+            if (context.hooks.acceptsLog()) {
+                context.hooks.onLog(LogLevel::Error, message);
             }
         }
     };
 
-    AirplayStreamer::AirplayStreamer(const Config &config) : impl_(std::make_unique<Impl>()) {
+    StreamerCore::StreamerCore(const Config &config, const SinkHooks hooks) : impl_(std::make_unique<Impl>(hooks)) {
+        if (config.on_tensor && (config.tensor.width <= 0 || config.tensor.height <= 0)) {
+            throw std::invalid_argument("Config::tensor needs a positive width and height");
+        }
         impl_->config = config;
 
-        impl_->initCodec();
         av_log_set_level(AV_LOG_INFO);
 
         // 初始化底层 Airplay
         raop_callbacks_t callbacks{};
         callbacks.cls = this; // 设置回调类指针
 
-        callbacks.conn_init = [](void *cls) {
-            // 连接初始化回调
+        callbacks.conn_init = [](void *cls) -> void * {
+            // 连接初始化回调，为这个连接创建独立的解码会话
+            auto *streamer = static_cast<StreamerCore *>(cls);
+            return streamer->impl_->createSession();
         };
 
-        callbacks.conn_destroy = [](void *cls) {
-            // 连接销毁回调
+        callbacks.conn_destroy = [](void *cls, void *conn_cls) {
+            // 连接销毁回调，此时 mirror 线程已经退出
+            auto *streamer = static_cast<StreamerCore *>(cls);
+            streamer->impl_->destroySession(static_cast<VideoSession *>(conn_cls));
         };
         callbacks.audio_process = [](void *cls, raop_ntp_t *ntp, aac_decode_struct *data) {
 
         };
-        callbacks.video_process = [](void *cls, raop_ntp_t *ntp, h264_decode_struct *data) {
-            auto *streamer = static_cast<AirplayStreamer *>(cls);
-
-            if (streamer && data && data->data && data->data_len > 0) {
-                AVPacket *pkt = av_packet_alloc();
-                if (!pkt) return;
-
-                pkt->data = static_cast<uint8_t *>(data->data);
-                pkt->size = data->data_len;
-                pkt->pts = data->pts;
-
-                AVFrame *frame = av_frame_alloc();
-                if (!frame) {
-                    av_packet_free(&pkt);
-                    return;
-                }
-
-                int ret = avcodec_send_packet(streamer->impl_->video_decoder, pkt);
-                if (ret == 0) {
-                    while (avcodec_receive_frame(streamer->impl_->video_decoder, frame) == 0) {
-                        // 创建智能指针包装
-                        auto frame_deleter = [](AVFrame *f) {
-                            if (f) av_frame_free(&f);
-                        };
-                        auto shared_frame = std::shared_ptr<AVFrame>(av_frame_clone(frame), frame_deleter);
-
-                        if (streamer->impl_->config.on_video_data) {
-                            streamer->impl_->config.on_video_data(shared_frame, data->pts);
-                        }
-                    }
-                }
-
-                av_frame_free(&frame);
-                av_packet_free(&pkt);
+        callbacks.video_process = [](void *cls, void *conn_cls, raop_ntp_t *ntp, h264_decode_struct *data) {
+            if (auto *session = static_cast<VideoSession *>(conn_cls)) {
+                session->process(data);
+            }
+        };
+        callbacks.video_get_buffer = [](void *cls, void *conn_cls, int size) -> unsigned char * {
+            auto *session = static_cast<VideoSession *>(conn_cls);
+            return session ? session->acquireBuffer(size) : nullptr;
+        };
+        callbacks.video_setup = [](void *cls, void *conn_cls) {
+            // 发送端建立 mirror 通道，参数集通常在几十毫秒后到达，趁这段时间在后台打开解码器
+            if (auto *session = static_cast<VideoSession *>(conn_cls)) {
+                session->prewarm();
+            }
+        };
+        callbacks.video_flush = [](void *cls, void *conn_cls) {
+            if (auto *session = static_cast<VideoSession *>(conn_cls)) {
+                session->flush();
             }
         };
 
@@ -110,12 +141,13 @@ namespace ender::airplay_streamer {
         if (!impl_->raop) {
             throw std::runtime_error("Failed to initialize RAOP");
         }
+        raop_set_low_latency(impl_->raop, impl_->config.low_latency ? 1 : 0);
 
         // 设置日志回调（正确的方式）
-        if (impl_->config.log_callback) {
+        if (impl_->context.hooks.acceptsLog()) {
             raop_set_log_callback(impl_->raop, [](void *cls, int level, const char *msg) {
-                auto *streamer = static_cast<AirplayStreamer *>(cls);
-                if (streamer && streamer->impl_->config.log_callback) {
+                auto *streamer = static_cast<StreamerCore *>(cls);
+                if (streamer) {
                     LogLevel log_level;
                     switch (level) {
                         case 0:
@@ -133,7 +165,8 @@ namespace ender::airplay_streamer {
                         default: log_level = LogLevel::Info;
                             break;
                     }
-                    streamer->impl_->config.log_callback(log_level, msg);
+                    const SinkHooks &hooks = streamer->impl_->context.hooks;
+                    hooks.onLog(log_level, msg);
                 }
             }, this);
         }
@@ -166,7 +199,7 @@ namespace ender::airplay_streamer {
         }
     }
 
-    AirplayStreamer::~AirplayStreamer() {
+    StreamerCore::~StreamerCore() {
         if (impl_) {
             if (impl_->raop) {
                 raop_stop(impl_->raop);
@@ -181,21 +214,60 @@ namespace ender::airplay_streamer {
                 impl_->dnssd = nullptr;
             }
 
-            if (impl_->video_decoder) {
-                avcodec_free_context(&impl_->video_decoder);
-            }
+            // raop_destroy 会销毁所有连接，这里只是兜底
+            std::lock_guard lock(impl_->sessions_mutex);
+            impl_->sessions.clear();
         }
     }
 
-    void AirplayStreamer::start() const {
+    void StreamerCore::start() const {
         impl_->running = true;
     }
 
-    void AirplayStreamer::stop() const {
+    void StreamerCore::stop() const {
         impl_->running = false;
     }
 
-    bool AirplayStreamer::isRunning() const {
+    bool StreamerCore::isRunning() const {
         return impl_->running && impl_->raop && raop_is_running(impl_->raop);
     }
+
+    std::vector<SessionStats> StreamerCore::sessionStats() const {
+        std::lock_guard lock(impl_->sessions_mutex);
+        std::vector<SessionStats> stats;
+        stats.reserve(impl_->sessions.size());
+        for (const auto &session: impl_->sessions) {
+            stats.push_back(session->stats());
+        }
+        return stats;
+    }
+
+    SubscriptionId StreamerCore::subscribe(AVFrameCallback callback, SubscriberOptions options) const {
+        if (!callback) {
+            throw std::invalid_argument("subscribe() needs a callback");
+        }
+        return impl_->context.fanout.subscribe(std::move(callback), std::move(options));
+    }
+
+    SubscriptionId StreamerCore::subscribe(std::shared_ptr<FrameQueue> queue, std::string name) const {
+        if (!queue) {
+            throw std::invalid_argument("subscribe() needs a queue");
+        }
+        return impl_->context.fanout.subscribe(std::move(queue), std::move(name));
+    }
+
+    SubscriptionId StreamerCore::subscribe(std::shared_ptr<FrameStream> stream) const {
+        if (!stream) {
+            throw std::invalid_argument("subscribe() needs a stream");
+        }
+        return impl_->context.fanout.subscribe(std::move(stream));
+    }
+
+    void StreamerCore::unsubscribe(const SubscriptionId id) const {
+        impl_->context.fanout.unsubscribe(id);
+    }
+
+    std::vector<SubscriberStats> StreamerCore::subscriberStats() const {
+        return impl_->context.fanout.stats();
+    }
 } // namespace airplay_streamer
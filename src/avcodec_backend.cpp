@@ -0,0 +1,110 @@
+// src/avcodec_backend.cpp
+
+#include "avcodec_backend.hpp"
+#include "decoder_pool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+}
+
+namespace ender::airplay_streamer {
+    namespace {
+        // 除解码线程各占一帧之外预留的帧缓冲：参考帧加上在用户手里的几帧
+        constexpr int kReservedFrames = 6;
+    }
+
+    AvcodecBackend::AvcodecBackend(DecoderPool &pool) : pool_(pool) {
+        packet_ = av_packet_alloc();
+        frame_ = av_frame_alloc();
+        if (!packet_ || !frame_) {
+            av_frame_free(&frame_);
+            av_packet_free(&packet_);
+            throw std::runtime_error("Failed to allocate decoder packet/frame.");
+        }
+    }
+
+    AvcodecBackend::~AvcodecBackend() {
+        if (ctx_) {
+            // 重置后放回池里，下一个会话或重连可以直接用
+            pool_.release(ctx_, settings_);
+        }
+        av_frame_free(&frame_);
+        av_packet_free(&packet_);
+    }
+
+    void AvcodecBackend::open(const DecoderParams &params, DecoderOutput &output) {
+        output_ = &output;
+        settings_ = decoderSettings(params);
+        avcc_.assign(params.avcc, params.avcc + params.avcc_size);
+
+        warm_ = (ctx_ = pool_.acquire(settings_)) != nullptr;
+        if (warm_) {
+            // 池里的解码器带着上一个流的参数集，新的随第一个包送入
+            output.attach(ctx_);
+            pending_extradata_ = avcc_;
+        } else {
+            ctx_ = openDecoder(settings_, nullptr, params.avcc, params.avcc_size);
+            output.attach(ctx_);
+            pending_extradata_.clear();
+        }
+        output.reserve(ctx_, params.width, params.height, settings_.thread_count + kReservedFrames);
+    }
+
+    bool AvcodecBackend::reconfigure(const DecoderParams &params) {
+        if (decoderSettings(params) != settings_) return false;
+
+        // 旋转、分辨率变化：libavcodec 收到新参数集后内部切换
+        if (!std::equal(params.avcc, params.avcc + params.avcc_size, avcc_.begin(), avcc_.end())) {
+            avcc_.assign(params.avcc, params.avcc + params.avcc_size);
+            pending_extradata_ = avcc_;
+        }
+        output_->reserve(ctx_, params.width, params.height, settings_.thread_count + kReservedFrames);
+        return true;
+    }
+
+    int AvcodecBackend::decode(AVBufferRef *buffer, const int size, const int64_t pts) {
+        // packet 接管 buffer 的引用，unref 时一并释放
+        packet_->buf = buffer;
+        packet_->data = buffer->data;
+        packet_->size = size;
+        packet_->pts = pts;
+        if (!pending_extradata_.empty()) {
+            if (uint8_t *side = av_packet_new_side_data(packet_, AV_PKT_DATA_NEW_EXTRADATA,
+                                                        pending_extradata_.size())) {
+                memcpy(side, pending_extradata_.data(), pending_extradata_.size());
+                pending_extradata_.clear();
+            }
+        }
+
+        const int ret = avcodec_send_packet(ctx_, packet_);
+        av_packet_unref(packet_);
+        if (ret < 0) return ret;
+
+        while (avcodec_receive_frame(ctx_, frame_) == 0) {
+            output_->emit(frame_);
+            av_frame_unref(frame_);
+        }
+        return 0;
+    }
+
+    void AvcodecBackend::flush() {
+        // 参数集保存在解码器里，flush 之后不需要重新送
+        avcodec_flush_buffers(ctx_);
+    }
+
+    void AvcodecBackend::setSkip(const DecodeSkip &skip) {
+        ctx_->skip_loop_filter = skip.loop_filter ? AVDISCARD_ALL : AVDISCARD_DEFAULT;
+        if (skip.non_key) {
+            ctx_->skip_frame = AVDISCARD_NONKEY;
+        } else if (skip.non_reference) {
+            ctx_->skip_frame = AVDISCARD_NONREF;
+        } else {
+            ctx_->skip_frame = AVDISCARD_DEFAULT;
+        }
+    }
+} // namespace airplay_streamer
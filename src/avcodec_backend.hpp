@@ -0,0 +1,51 @@
+// src/avcodec_backend.hpp
+#pragma once
+
+#include <decoder_backend.hpp>
+#include "decoder_settings.hpp"
+
+#include <cstdint>
+#include <vector>
+
+struct AVCodecContext;
+struct AVFrame;
+struct AVPacket;
+
+namespace ender::airplay_streamer {
+    class DecoderPool;
+
+    // 默认后端：libavcodec 的 H.264 解码器。
+    // 解码器优先从 DecoderPool 取预热好的，析构时 flush 后放回池里；
+    // 线程设置不变时参数集变化不重开解码器，新的 avcC 随下一个包以 NEW_EXTRADATA 送入
+    class AvcodecBackend final : public DecoderBackend {
+    public:
+        explicit AvcodecBackend(DecoderPool &pool);
+
+        ~AvcodecBackend() override;
+
+        const char *name() const override { return warm_ ? "libavcodec (warm)" : "libavcodec"; }
+
+        void open(const DecoderParams &params, DecoderOutput &output) override;
+
+        bool reconfigure(const DecoderParams &params) override;
+
+        int decode(AVBufferRef *buffer, int size, int64_t pts) override;
+
+        void flush() override;
+
+        void setSkip(const DecodeSkip &skip) override;
+
+    private:
+        DecoderPool &pool_;
+        DecoderOutput *output_ = nullptr;
+        AVCodecContext *ctx_ = nullptr;
+        DecoderSettings settings_;
+        bool warm_ = false;
+        AVPacket *packet_ = nullptr;
+        AVFrame *frame_ = nullptr;
+
+        // 解码器当前使用的 avcC，以及等着随下一个包送进去的新 avcC
+        std::vector<uint8_t> avcc_;
+        std::vector<uint8_t> pending_extradata_;
+    };
+} // namespace airplay_streamer
@@ -0,0 +1,108 @@
+// src/content_detector.cpp
+
+#include "content_detector.hpp"
+#include "yuv_convert.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AIRPLAY_CONTENT_SSE2 1
+#endif
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace ender::airplay_streamer {
+    namespace {
+        // 列扫描隔行采样，黑边检测不需要逐行精确
+        constexpr int kColumnRowStep = 2;
+
+        // 这一行是否有亮度超过 black 的像素
+        bool rowHasContent(const uint8_t *row, const int width, const uint8_t black) {
+            int x = 0;
+#ifdef AIRPLAY_CONTENT_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i level = _mm_set1_epi8(static_cast<char>(black));
+            for (; x + 16 <= width; x += 16) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(v, level), zero)) != 0xffff) return true;
+            }
+#endif
+            for (; x < width; ++x) {
+                if (row[x] > black) return true;
+            }
+            return false;
+        }
+
+        // 逐列取最大值，一行一行累积，访问顺序与内存布局一致
+        void accumulateMax(const uint8_t *row, uint8_t *column_max, const int width) {
+            int x = 0;
+#ifdef AIRPLAY_CONTENT_SSE2
+            for (; x + 16 <= width; x += 16) {
+                auto *dst = reinterpret_cast<__m128i *>(column_max + x);
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+                _mm_storeu_si128(dst, _mm_max_epu8(_mm_loadu_si128(dst), v));
+            }
+#endif
+            for (; x < width; ++x) {
+                column_max[x] = std::max(column_max[x], row[x]);
+            }
+        }
+    }
+
+    ContentDetector::ContentDetector(const ContentCrop &policy)
+        : black_level_(std::clamp(policy.black_level, 0, 255)), interval_(std::max(policy.interval, 1)) {
+    }
+
+    bool ContentDetector::update(const AVFrame *frame) {
+        const ContentRect previous = rect_;
+        if (frame->width != width_ || frame->height != height_) {
+            width_ = frame->width;
+            height_ = frame->height;
+            rect_ = {0, 0, width_, height_};
+            countdown_ = 0;
+        }
+        if (--countdown_ > 0) return rect_ != previous;
+        countdown_ = interval_;
+
+        ContentRect detected;
+        // 全黑的帧（切换画面时常见）不更新结果
+        if (yuv::hasLumaPlane(frame) && detect(frame, detected)) {
+            rect_ = detected;
+        }
+        return rect_ != previous;
+    }
+
+    bool ContentDetector::detect(const AVFrame *frame, ContentRect &out) {
+        const int width = frame->width;
+        const int height = frame->height;
+        const uint8_t *luma = frame->data[0];
+        const int stride = frame->linesize[0];
+        const auto black = static_cast<uint8_t>(black_level_);
+
+        auto row = [luma, stride](const int y) { return luma + static_cast<ptrdiff_t>(y) * stride; };
+
+        int top = 0;
+        while (top < height && !rowHasContent(row(top), width, black)) ++top;
+        if (top == height) return false;
+        int bottom = height - 1;
+        while (bottom > top && !rowHasContent(row(bottom), width, black)) --bottom;
+
+        column_max_.assign(width, 0);
+        for (int y = top; y <= bottom; y += kColumnRowStep) {
+            accumulateMax(row(y), column_max_.data(), width);
+        }
+        int left = 0;
+        while (left < width && column_max_[left] <= black) ++left;
+        int right = width - 1;
+        while (right > left && column_max_[right] <= black) --right;
+
+        // 对称裁剪并保持偶数，4:2:0 的色度平面才能对齐
+        const int margin_x = std::min(left, width - 1 - right) & ~1;
+        const int margin_y = std::min(top, height - 1 - bottom) & ~1;
+        out = {margin_x, margin_y, width - 2 * margin_x, height - 2 * margin_y};
+        return true;
+    }
+} // namespace airplay_streamer
@@ -0,0 +1,48 @@
+// src/content_detector.hpp
+#pragma once
+
+#include <airplay_streamer.hpp>
+
+#include <vector>
+
+struct AVFrame;
+
+namespace ender::airplay_streamer {
+    // 帧中实际有画面的区域（去掉上下/左右黑边），偏移和尺寸都是偶数
+    struct ContentRect {
+        int left = 0;
+        int top = 0;
+        int width = 0;
+        int height = 0;
+
+        bool operator==(const ContentRect &other) const = default;
+    };
+
+    // 竖屏 iPhone 镜像到 1920x1080 时画面两侧是大块黑边。
+    // 分辨率变化时立即检测，之后每隔 interval 帧重新检测一次，其余帧沿用上次结果。
+    // 镜像画面总是居中，黑边按两侧较窄的一边对称裁掉，暗色界面贴边的内容不会被误裁。
+    // 只在一个线程上使用
+    class ContentDetector {
+    public:
+        explicit ContentDetector(const ContentCrop &policy);
+
+        // 需要时重新检测；返回内容区域是否变化
+        bool update(const AVFrame *frame);
+
+        // 当前内容区域，没有黑边时为整帧
+        const ContentRect &rect() const { return rect_; }
+
+        bool cropped() const { return rect_.width < width_ || rect_.height < height_; }
+
+    private:
+        bool detect(const AVFrame *frame, ContentRect &out);
+
+        int black_level_;
+        int interval_;
+        int countdown_ = 0;
+        int width_ = 0;
+        int height_ = 0;
+        ContentRect rect_;
+        std::vector<uint8_t> column_max_;
+    };
+} // namespace airplay_streamer
@@ -0,0 +1,50 @@
+// src/decode_shedder.cpp
+
+#include "decode_shedder.hpp"
+
+namespace ender::airplay_streamer {
+    namespace {
+        // 连续落后这么多帧才降级，避免偶发的抖动
+        constexpr int kEscalateAfter = 3;
+        // 连续跟上这么多帧（60fps 下约 1 秒）才升一级
+        constexpr int kRecoverAfter = 60;
+        // 只解关键帧时参考帧链已经断了，要等关键帧再恢复；等太久就接受花屏直接恢复
+        constexpr int kKeyframeWaitLimit = 180;
+        // 超过这个值说明 NTP 还没同步，不作为依据
+        constexpr int64_t kMaxPlausibleLagUs = 10'000'000;
+    }
+
+    bool DecodeShedder::update(const size_t queue_depth, const size_t queue_capacity, int64_t lag_us,
+                               const bool keyframe) {
+        if (!policy_.enabled) return false;
+        if (lag_us > kMaxPlausibleLagUs) lag_us = -1;
+
+        const int64_t max_lag_us = static_cast<int64_t>(policy_.max_lag_ms) * 1000;
+        const int64_t recover_lag_us = static_cast<int64_t>(policy_.recover_lag_ms) * 1000;
+        const bool behind = queue_depth * 2 > queue_capacity || lag_us > max_lag_us;
+        const bool caught_up = queue_depth <= 1 && lag_us <= recover_lag_us;
+
+        if (behind) {
+            caught_up_ = 0;
+            if (++behind_ < kEscalateAfter || level_ == ShedLevel::KeyframesOnly) return false;
+            behind_ = 0;
+            level_ = static_cast<ShedLevel>(static_cast<int>(level_) + 1);
+            return true;
+        }
+        behind_ = 0;
+
+        if (!caught_up || level_ == ShedLevel::Full) {
+            caught_up_ = 0;
+            return false;
+        }
+        ++caught_up_;
+        if (level_ == ShedLevel::KeyframesOnly) {
+            if (!(keyframe && caught_up_ >= kRecoverAfter) && caught_up_ < kKeyframeWaitLimit) return false;
+        } else if (caught_up_ < kRecoverAfter) {
+            return false;
+        }
+        caught_up_ = 0;
+        level_ = static_cast<ShedLevel>(static_cast<int>(level_) - 1);
+        return true;
+    }
+} // namespace airplay_streamer
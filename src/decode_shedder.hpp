@@ -0,0 +1,29 @@
+// src/decode_shedder.hpp
+#pragma once
+
+#include <airplay_streamer.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ender::airplay_streamer {
+    // 解码跟不上时逐级降低解码质量：跳过去块滤波 -> 跳过非参考帧 -> 只解关键帧，
+    // 追上之后再逐级恢复。只在 worker 线程上使用
+    class DecodeShedder {
+    public:
+        explicit DecodeShedder(const SheddingPolicy &policy) : policy_(policy) {
+        }
+
+        // 每个待解码的视频帧调用一次。lag_us 为发送端时间戳到现在的延迟，未知时传负数。
+        // 级别发生变化时返回 true
+        bool update(size_t queue_depth, size_t queue_capacity, int64_t lag_us, bool keyframe);
+
+        ShedLevel level() const { return level_; }
+
+    private:
+        const SheddingPolicy &policy_;
+        ShedLevel level_ = ShedLevel::Full;
+        int behind_ = 0;    // 连续落后的帧数
+        int caught_up_ = 0; // 连续跟上的帧数
+    };
+} // namespace airplay_streamer
@@ -0,0 +1,139 @@
+// src/decoder_pool.cpp
+
+#include "decoder_pool.hpp"
+
+#include <algorithm>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+namespace ender::airplay_streamer {
+    DecoderPool::~DecoderPool() {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        for (Entry &entry: idle_) {
+            avcodec_free_context(&entry.ctx);
+        }
+    }
+
+    AVCodecContext *DecoderPool::acquire(const DecoderSettings &settings) {
+        std::lock_guard lock(mutex_);
+        // 从最近归还的开始找，它的缓存最热
+        for (auto it = idle_.rbegin(); it != idle_.rend(); ++it) {
+            if (it->settings == settings) {
+                AVCodecContext *ctx = it->ctx;
+                idle_.erase(std::next(it).base());
+                return ctx;
+            }
+        }
+        return nullptr;
+    }
+
+    void DecoderPool::release(AVCodecContext *ctx, const DecoderSettings &settings) {
+        if (!ctx) return;
+
+        // 丢掉内部缓存的帧，并且不再引用会话的帧池
+        avcodec_flush_buffers(ctx);
+        ctx->opaque = nullptr;
+
+        AVCodecContext *evicted = nullptr;
+        {
+            std::lock_guard lock(mutex_);
+            if (stopping_) {
+                evicted = ctx;
+            } else {
+                if (idle_.size() >= kMaxIdle) {
+                    evicted = idle_.front().ctx;
+                    idle_.erase(idle_.begin());
+                }
+                idle_.push_back({ctx, settings, std::chrono::steady_clock::now()});
+                startLocked();
+            }
+        }
+        cv_.notify_all();
+        avcodec_free_context(&evicted);
+    }
+
+    void DecoderPool::prewarm(const DecoderSettings &settings) {
+        {
+            std::lock_guard lock(mutex_);
+            if (stopping_) return;
+            const auto has = [&settings](const Entry &entry) { return entry.settings == settings; };
+            if (std::any_of(idle_.begin(), idle_.end(), has) ||
+                std::find(requests_.begin(), requests_.end(), settings) != requests_.end()) {
+                return;
+            }
+            requests_.push_back(settings);
+            startLocked();
+        }
+        cv_.notify_all();
+    }
+
+    void DecoderPool::startLocked() {
+        if (!thread_.joinable()) {
+            thread_ = std::thread(&DecoderPool::run, this);
+        }
+    }
+
+    void DecoderPool::run() {
+        std::unique_lock lock(mutex_);
+        while (!stopping_) {
+            if (!requests_.empty()) {
+                const DecoderSettings settings = requests_.front();
+                requests_.erase(requests_.begin());
+
+                // 打开解码器比较慢，不占着锁
+                lock.unlock();
+                AVCodecContext *ctx = nullptr;
+                try {
+                    ctx = openDecoder(settings, nullptr);
+                } catch (const std::exception &) {
+                    // 预热失败不要紧，会话拿不到时会自己打开
+                }
+                lock.lock();
+
+                if (ctx) {
+                    if (stopping_ || idle_.size() >= kMaxIdle) {
+                        avcodec_free_context(&ctx);
+                    } else {
+                        idle_.push_back({ctx, settings, std::chrono::steady_clock::now()});
+                    }
+                }
+                continue;
+            }
+
+            // 释放空闲太久的解码器
+            const auto now = std::chrono::steady_clock::now();
+            std::vector<AVCodecContext *> expired;
+            std::erase_if(idle_, [&](const Entry &entry) {
+                if (now - entry.idle_since < kIdleTimeout) return false;
+                expired.push_back(entry.ctx);
+                return true;
+            });
+            if (!expired.empty()) {
+                lock.unlock();
+                for (AVCodecContext *ctx: expired) {
+                    avcodec_free_context(&ctx);
+                }
+                lock.lock();
+                continue;
+            }
+
+            if (idle_.empty()) {
+                cv_.wait(lock);
+            } else {
+                const auto oldest = std::min_element(idle_.begin(), idle_.end(), [](const Entry &a, const Entry &b) {
+                    return a.idle_since < b.idle_since;
+                });
+                cv_.wait_until(lock, oldest->idle_since + kIdleTimeout);
+            }
+        }
+    }
+} // namespace airplay_streamer
@@ -0,0 +1,60 @@
+// src/decoder_pool.hpp
+#pragma once
+
+#include "decoder_settings.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct AVCodecContext;
+
+namespace ender::airplay_streamer {
+    // 预先打开、已重置的解码器池，按 DecoderSettings 匹配。
+    // 会话结束时解码器 flush 后放回池里，新会话或重连可以直接拿来用；
+    // 空闲超过 kIdleTimeout 的解码器由后台线程释放，空闲的接收端不占解码器内存
+    class DecoderPool {
+    public:
+        DecoderPool() = default;
+
+        ~DecoderPool();
+
+        DecoderPool(const DecoderPool &) = delete;
+
+        DecoderPool &operator=(const DecoderPool &) = delete;
+
+        // 取出一个设置相同的空闲解码器，没有时返回 nullptr。
+        // 取出的解码器没有挂帧池，参数集是上一个流的
+        AVCodecContext *acquire(const DecoderSettings &settings);
+
+        // 归还解码器：flush 并摘掉帧池后放回池中，池满时直接释放
+        void release(AVCodecContext *ctx, const DecoderSettings &settings);
+
+        // 池里没有这种设置的解码器时，在后台线程上打开一个
+        void prewarm(const DecoderSettings &settings);
+
+    private:
+        static constexpr size_t kMaxIdle = 2;
+        static constexpr std::chrono::seconds kIdleTimeout{30};
+
+        struct Entry {
+            AVCodecContext *ctx = nullptr;
+            DecoderSettings settings;
+            std::chrono::steady_clock::time_point idle_since;
+        };
+
+        // 调用方持有 mutex_
+        void startLocked();
+
+        void run();
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::vector<Entry> idle_;
+        std::vector<DecoderSettings> requests_;
+        bool stopping_ = false;
+        std::thread thread_;
+    };
+} // namespace airplay_streamer
@@ -0,0 +1,167 @@
+// src/decoder_settings.cpp
+
+#include "decoder_settings.hpp"
+#include "frame_pool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/mem.h>
+}
+
+namespace ender::airplay_streamer {
+    namespace {
+        // 低于这个像素数时多线程的调度开销比收益大
+        constexpr int kThreadingMinPixels = 1280 * 720;
+        // libavcodec 帧线程的上限
+        constexpr int kMaxFrameThreads = 16;
+        constexpr int kMaxSliceThreads = 8;
+    }
+
+    DecoderSettings chooseDecoderSettings(const Config &config, const int width, const int height,
+                                          const int decoding_sessions) {
+        const DecoderThreading &threading = config.decoder_threading;
+
+        DecoderSettings settings;
+        if (threading.fast) {
+            settings.flags2 |= AV_CODEC_FLAG2_FAST;
+        }
+        if (config.low_latency) {
+            settings.flags |= AV_CODEC_FLAG_LOW_DELAY;
+        }
+        if (config.export_motion_vectors) {
+            settings.flags2 |= AV_CODEC_FLAG2_EXPORT_MVS;
+        }
+
+        const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        const int budget = std::max(1, cores / std::max(1, decoding_sessions));
+
+        switch (threading.type) {
+            case DecoderThreadType::Frame:
+                if (config.low_latency) {
+                    // 帧线程每个线程都要多缓存一帧，低延迟模式下退回片线程，线程数按片线程的上限
+                    settings.thread_type = FF_THREAD_SLICE;
+                    settings.thread_count = std::min(threading.thread_count > 0 ? threading.thread_count : budget,
+                                                     kMaxSliceThreads);
+                } else {
+                    settings.thread_type = FF_THREAD_FRAME;
+                    settings.thread_count = threading.thread_count > 0
+                                                ? threading.thread_count
+                                                : std::min(budget, kMaxFrameThreads);
+                }
+                break;
+            case DecoderThreadType::Slice:
+                settings.thread_type = FF_THREAD_SLICE;
+                settings.thread_count = threading.thread_count > 0
+                                            ? threading.thread_count
+                                            : std::min(budget, kMaxSliceThreads);
+                break;
+            case DecoderThreadType::Auto:
+            default:
+                if (static_cast<int64_t>(width) * height < kThreadingMinPixels) {
+                    settings.thread_count = 1;
+                } else if (config.low_latency) {
+                    // 片级并行不增加延迟，帧级并行每多一个线程多缓存一帧
+                    settings.thread_type = FF_THREAD_SLICE;
+                    settings.thread_count = std::min(budget, kMaxSliceThreads);
+                } else {
+                    settings.thread_type = FF_THREAD_FRAME;
+                    settings.thread_count = std::min(budget, kMaxFrameThreads);
+                }
+                if (threading.thread_count > 0) {
+                    settings.thread_count = std::min(settings.thread_count, threading.thread_count);
+                }
+                break;
+        }
+
+        if (settings.thread_count <= 1) {
+            settings.thread_count = 1;
+            settings.thread_type = 0;
+        }
+        return settings;
+    }
+
+    AVCodecContext *openDecoder(const DecoderSettings &settings, FramePool *pool, const uint8_t *avcc,
+                                const size_t avcc_size) {
+        const AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_H264);
+        if (!codec) {
+            throw std::runtime_error("Cannot find H.264 decoder.");
+        }
+
+        AVCodecContext *ctx = avcodec_alloc_context3(codec);
+        if (!ctx) {
+            throw std::runtime_error("Failed to allocate video decoder context.");
+        }
+
+        ctx->thread_count = settings.thread_count;
+        ctx->thread_type = settings.thread_type;
+        ctx->flags |= settings.flags;
+        ctx->flags2 |= settings.flags2;
+        if (pool) {
+            pool->attach(ctx);
+        }
+
+        if (avcc && avcc_size > 0) {
+            ctx->extradata = static_cast<uint8_t *>(av_mallocz(avcc_size + AV_INPUT_BUFFER_PADDING_SIZE));
+            if (!ctx->extradata) {
+                avcodec_free_context(&ctx);
+                throw std::runtime_error("Failed to allocate decoder extradata.");
+            }
+            memcpy(ctx->extradata, avcc, avcc_size);
+            ctx->extradata_size = static_cast<int>(avcc_size);
+        }
+
+        if (avcodec_open2(ctx, codec, nullptr) < 0) {
+            avcodec_free_context(&ctx);
+            throw std::runtime_error("Failed to open H.264 decoder.");
+        }
+        return ctx;
+    }
+
+    DecoderParams decoderParams(const DecoderSettings &settings, const Config &config) {
+        DecoderParams params;
+        params.thread_count = settings.thread_count;
+        switch (settings.thread_type) {
+            case FF_THREAD_FRAME: params.thread_type = DecoderThreadType::Frame;
+                break;
+            case FF_THREAD_SLICE: params.thread_type = DecoderThreadType::Slice;
+                break;
+            default: params.thread_type = DecoderThreadType::Auto;
+                break;
+        }
+        params.low_latency = (settings.flags & AV_CODEC_FLAG_LOW_DELAY) != 0;
+        params.fast = (settings.flags2 & AV_CODEC_FLAG2_FAST) != 0;
+        params.export_motion_vectors = config.export_motion_vectors;
+        return params;
+    }
+
+    DecoderSettings decoderSettings(const DecoderParams &params) {
+        DecoderSettings settings;
+        settings.thread_count = std::max(params.thread_count, 1);
+        switch (params.thread_type) {
+            case DecoderThreadType::Frame: settings.thread_type = FF_THREAD_FRAME;
+                break;
+            case DecoderThreadType::Slice: settings.thread_type = FF_THREAD_SLICE;
+                break;
+            default: settings.thread_type = 0;
+                break;
+        }
+        if (settings.thread_count == 1) settings.thread_type = 0;
+        if (params.low_latency) settings.flags |= AV_CODEC_FLAG_LOW_DELAY;
+        if (params.fast) settings.flags2 |= AV_CODEC_FLAG2_FAST;
+        if (params.export_motion_vectors) settings.flags2 |= AV_CODEC_FLAG2_EXPORT_MVS;
+        return settings;
+    }
+
+    const char *threadTypeName(const DecoderThreadType thread_type) {
+        switch (thread_type) {
+            case DecoderThreadType::Frame: return "frame";
+            case DecoderThreadType::Slice: return "slice";
+            default: return "none";
+        }
+    }
+} // namespace airplay_streamer
@@ -0,0 +1,41 @@
+// src/decoder_settings.hpp
+#pragma once
+
+#include <airplay_streamer.hpp>
+#include <decoder_backend.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+struct AVCodecContext;
+
+namespace ender::airplay_streamer {
+    class FramePool;
+
+    // avcodec_open2 之前就要确定、打开后不能再改的解码器参数
+    struct DecoderSettings {
+        int thread_count = 1;
+        int thread_type = 0; // FF_THREAD_FRAME / FF_THREAD_SLICE
+        int flags = 0;
+        int flags2 = 0;
+
+        bool operator==(const DecoderSettings &other) const = default;
+    };
+
+    // 根据配置、编码分辨率和正在解码的会话数决定线程方式。
+    // Auto 模式下所有会话的解码线程总数不超过 CPU 核数
+    DecoderSettings chooseDecoderSettings(const Config &config, int width, int height, int decoding_sessions);
+
+    // 按 settings 打开一个 H.264 解码器，帧缓冲从 pool 分配（为空时之后再 attach）；失败时抛出 std::runtime_error。
+    // avcc 为流的 avcC 记录，此后送入的包都是 AVCC 格式；为空时参数集要随后通过
+    // AV_PKT_DATA_NEW_EXTRADATA 送入
+    AVCodecContext *openDecoder(const DecoderSettings &settings, FramePool *pool,
+                                const uint8_t *avcc = nullptr, size_t avcc_size = 0);
+
+    // 和后端无关的 DecoderParams 与 libavcodec 的设置互相转换
+    DecoderParams decoderParams(const DecoderSettings &settings, const Config &config);
+
+    DecoderSettings decoderSettings(const DecoderParams &params);
+
+    const char *threadTypeName(DecoderThreadType thread_type);
+} // namespace airplay_streamer
@@ -0,0 +1,87 @@
+// src/dirty_tracker.cpp
+
+#include "dirty_tracker.hpp"
+#include "yuv_convert.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AIRPLAY_DIRTY_SSE2 1
+#endif
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace ender::airplay_streamer {
+    namespace {
+        constexpr int kMinTileSize = 16;
+    }
+
+    DirtyTracker::DirtyTracker(const DirtyTracking &policy)
+        : tile_size_(std::max(policy.tile_size, kMinTileSize)),
+          threshold_(std::clamp(policy.threshold, 0, 255)) {
+    }
+
+    bool DirtyTracker::tileChanged(const uint8_t *a, const int a_stride, const uint8_t *b, const int b_stride,
+                                   const int width, const int height) const {
+        for (int row = 0; row < height; ++row) {
+            const uint8_t *pa = a + static_cast<ptrdiff_t>(row) * a_stride;
+            const uint8_t *pb = b + static_cast<ptrdiff_t>(row) * b_stride;
+            int x = 0;
+#ifdef AIRPLAY_DIRTY_SSE2
+            // |a - b| 用两次饱和减法取得，再减去阈值，非零即超出
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i threshold = _mm_set1_epi8(static_cast<char>(threshold_));
+            for (; x + 16 <= width; x += 16) {
+                const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pa + x));
+                const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pb + x));
+                const __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+                const __m128i excess = _mm_subs_epu8(diff, threshold);
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(excess, zero)) != 0xffff) return true;
+            }
+#endif
+            for (; x < width; ++x) {
+                if (std::abs(pa[x] - pb[x]) > threshold_) return true;
+            }
+        }
+        return false;
+    }
+
+    bool DirtyTracker::compare(const AVFrame *frame, TileMap &out) const {
+        out.tile_size = tile_size_;
+        out.columns = (frame->width + tile_size_ - 1) / tile_size_;
+        out.rows = (frame->height + tile_size_ - 1) / tile_size_;
+        const size_t count = static_cast<size_t>(out.columns) * out.rows;
+
+        const AVFrame *ref = reference_.get();
+        out.full = !ref || !yuv::hasLumaPlane(frame) || ref->width != frame->width || ref->height != frame->height ||
+                   !yuv::hasLumaPlane(ref);
+        if (out.full) {
+            out.dirty.assign(count, 1);
+            out.dirty_tiles = static_cast<int>(count);
+            return true;
+        }
+
+        out.dirty.assign(count, 0);
+        out.dirty_tiles = 0;
+        for (int ty = 0; ty < out.rows; ++ty) {
+            const int y = ty * tile_size_;
+            const int h = std::min(tile_size_, frame->height - y);
+            for (int tx = 0; tx < out.columns; ++tx) {
+                const int x = tx * tile_size_;
+                const int w = std::min(tile_size_, frame->width - x);
+                if (tileChanged(frame->data[0] + static_cast<ptrdiff_t>(y) * frame->linesize[0] + x,
+                                frame->linesize[0],
+                                ref->data[0] + static_cast<ptrdiff_t>(y) * ref->linesize[0] + x,
+                                ref->linesize[0], w, h)) {
+                    out.dirty[static_cast<size_t>(ty) * out.columns + tx] = 1;
+                    ++out.dirty_tiles;
+                }
+            }
+        }
+        return out.dirty_tiles > 0;
+    }
+} // namespace airplay_streamer
@@ -0,0 +1,33 @@
+// src/dirty_tracker.hpp
+#pragma once
+
+#include <airplay_streamer.hpp>
+
+#include <memory>
+
+struct AVFrame;
+
+namespace ender::airplay_streamer {
+    // 把每一帧的亮度平面按 tile 与上一次交付的帧比较。
+    // 参考帧只是对解码输出的一个引用，不复制像素；帧内容一旦输出就不会再被解码器改写。
+    // 只在一个线程上使用
+    class DirtyTracker {
+    public:
+        explicit DirtyTracker(const DirtyTracking &policy);
+
+        // 与参考帧比较，结果写进 out；返回是否有 tile 变化（没有参考帧时总是 true）
+        bool compare(const AVFrame *frame, TileMap &out) const;
+
+        // frame 已经交付，之后的帧与它比较
+        void accept(std::shared_ptr<AVFrame> frame) { reference_ = std::move(frame); }
+
+        void reset() { reference_.reset(); }
+
+    private:
+        bool tileChanged(const uint8_t *a, int a_stride, const uint8_t *b, int b_stride, int width, int height) const;
+
+        int tile_size_;
+        int threshold_;
+        std::shared_ptr<AVFrame> reference_;
+    };
+} // namespace airplay_streamer
@@ -0,0 +1,95 @@
+// src/frame_extras.cpp
+
+#include "frame_extras_pool.hpp"
+
+#include <mutex>
+
+extern "C" {
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+}
+
+namespace ender::airplay_streamer {
+    namespace {
+        // 帧可能比会话活得久，池是进程级的
+        class ExtrasPool {
+        public:
+            static ExtrasPool &instance() {
+                static auto *pool = new ExtrasPool(); // 故意不析构，进程退出时还可能有帧在归还
+                return *pool;
+            }
+
+            FrameExtras *acquire() {
+                {
+                    std::lock_guard lock(mutex_);
+                    if (!idle_.empty()) {
+                        FrameExtras *extras = idle_.back();
+                        idle_.pop_back();
+                        return extras;
+                    }
+                }
+                return new FrameExtras();
+            }
+
+            void release(FrameExtras *extras) {
+                // 先在锁外清空，释放挂着的帧时可能又会回到这里；保留 vector 的容量给下一帧用
+                extras->ladder.clear();
+                extras->tiles.tile_size = 0;
+                extras->tiles.columns = 0;
+                extras->tiles.rows = 0;
+                extras->tiles.dirty.clear();
+                extras->tiles.dirty_tiles = 0;
+                extras->tiles.full = false;
+                extras->analytics.computed = false;
+                extras->motion.columns = 0;
+                extras->motion.rows = 0;
+                extras->motion.blocks.clear();
+                extras->motion.moving_blocks = 0;
+                extras->motion.mean_magnitude = 0.0f;
+                std::lock_guard lock(mutex_);
+                if (idle_.size() < kMaxIdle) {
+                    idle_.push_back(extras);
+                    return;
+                }
+                delete extras;
+            }
+
+        private:
+            static constexpr size_t kMaxIdle = 64;
+
+            std::mutex mutex_;
+            std::vector<FrameExtras *> idle_;
+        };
+
+        // AVBuffer 里放的是 FrameExtras 本身的地址
+        void freeExtras(void *, uint8_t *data) {
+            ExtrasPool::instance().release(reinterpret_cast<FrameExtras *>(data));
+        }
+
+        bool isExtras(const AVBufferRef *ref) {
+            return ref && ref->size == sizeof(FrameExtras) && av_buffer_get_opaque(ref) == &ExtrasPool::instance();
+        }
+    }
+
+    const FrameExtras *frameExtras(const AVFrame *frame) {
+        if (!frame || !isExtras(frame->opaque_ref)) return nullptr;
+        return reinterpret_cast<const FrameExtras *>(frame->opaque_ref->data);
+    }
+
+    FrameExtras *attachFrameExtras(AVFrame *frame) {
+        if (isExtras(frame->opaque_ref)) {
+            return reinterpret_cast<FrameExtras *>(frame->opaque_ref->data);
+        }
+
+        FrameExtras *extras = ExtrasPool::instance().acquire();
+        AVBufferRef *ref = av_buffer_create(reinterpret_cast<uint8_t *>(extras), sizeof(FrameExtras), &freeExtras,
+                                            &ExtrasPool::instance(), 0);
+        if (!ref) {
+            ExtrasPool::instance().release(extras);
+            return nullptr;
+        }
+        av_buffer_unref(&frame->opaque_ref);
+        frame->opaque_ref = ref;
+        return extras;
+    }
+} // namespace airplay_streamer
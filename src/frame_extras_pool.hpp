@@ -0,0 +1,10 @@
+// src/frame_extras_pool.hpp
+#pragma once
+
+#include <frame_extras.hpp>
+
+namespace ender::airplay_streamer {
+    // 给 frame 挂上一个空的 FrameExtras 并返回它，已经有的话直接返回。
+    // FrameExtras 对象会回收复用，帧释放时内容被清空后回到池里
+    FrameExtras *attachFrameExtras(AVFrame *frame);
+} // namespace airplay_streamer
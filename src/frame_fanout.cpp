@@ -0,0 +1,314 @@
+// src/frame_fanout.cpp
+
+#include "frame_fanout.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <thread>
+
+namespace ender::airplay_streamer {
+    class FrameFanout::Entry {
+    public:
+        virtual ~Entry() = default;
+
+        virtual SubscriptionId id() const = 0;
+
+        virtual void push(const std::shared_ptr<AVFrame> &frame, int64_t pts, uint64_t session_id) = 0;
+
+        // 是否接收这个会话的帧
+        virtual bool accepts(uint64_t) const { return true; }
+
+        virtual void sessionEnded(uint64_t) {
+        }
+
+        virtual void stop() = 0;
+
+        virtual SubscriberStats stats() const = 0;
+    };
+
+    class FrameFanout::Subscriber final : public Entry {
+    public:
+        Subscriber(const SubscriptionId id, AVFrameCallback callback, SubscriberOptions options)
+            : id_(id), callback_(std::move(callback)), options_(std::move(options)),
+              ring_(std::max<size_t>(options_.queue_capacity, 1)) {
+        }
+
+        SubscriptionId id() const override { return id_; }
+
+        // 线程持有自己的引用，自己的回调里取消订阅时可以分离线程
+        static void start(const std::shared_ptr<Subscriber> &self) {
+            self->thread_ = std::thread([self] { self->run(); });
+        }
+
+        void push(const std::shared_ptr<AVFrame> &frame, const int64_t pts, uint64_t) override {
+            {
+                std::lock_guard lock(mutex_);
+                if (stopping_) return;
+                if (size_ == ring_.size()) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    if (options_.drop_policy == DropPolicy::DropNewest) return;
+                    // 新帧顶替最旧的一帧，队头后移一位
+                    ring_[head_] = Item{frame, pts};
+                    head_ = (head_ + 1) % ring_.size();
+                    return;
+                }
+                ring_[(head_ + size_) % ring_.size()] = Item{frame, pts};
+                ++size_;
+            }
+            cv_.notify_one();
+        }
+
+        void stop() override {
+            {
+                std::lock_guard lock(mutex_);
+                stopping_ = true;
+            }
+            cv_.notify_one();
+            if (!thread_.joinable()) return;
+            if (thread_.get_id() == std::this_thread::get_id()) {
+                thread_.detach();
+            } else {
+                thread_.join();
+            }
+        }
+
+        SubscriberStats stats() const override {
+            SubscriberStats stats;
+            stats.id = id_;
+            stats.name = options_.name;
+            stats.queue_capacity = ring_.size();
+            {
+                std::lock_guard lock(mutex_);
+                stats.queue_depth = size_;
+            }
+            stats.frames_delivered = delivered_.load(std::memory_order_relaxed);
+            stats.frames_dropped = dropped_.load(std::memory_order_relaxed);
+            return stats;
+        }
+
+    private:
+        struct Item {
+            std::shared_ptr<AVFrame> frame;
+            int64_t pts = 0;
+        };
+
+        void run() {
+            while (true) {
+                Item item;
+                {
+                    std::unique_lock lock(mutex_);
+                    cv_.wait(lock, [this] { return stopping_ || size_ > 0; });
+                    if (stopping_) break;
+                    item = std::move(ring_[head_]);
+                    head_ = (head_ + 1) % ring_.size();
+                    --size_;
+                }
+                callback_(std::move(item.frame), item.pts);
+                delivered_.fetch_add(1, std::memory_order_relaxed);
+            }
+            // 还在排队的帧随订阅者一起释放
+        }
+
+        const SubscriptionId id_;
+        const AVFrameCallback callback_;
+        const SubscriberOptions options_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        std::vector<Item> ring_;
+        size_t head_ = 0;
+        size_t size_ = 0;
+        bool stopping_ = false;
+        std::thread thread_;
+
+        std::atomic<uint64_t> delivered_{0};
+        std::atomic<uint64_t> dropped_{0};
+    };
+
+    class FrameFanout::QueueEntry final : public Entry {
+    public:
+        QueueEntry(const SubscriptionId id, std::shared_ptr<FrameQueue> queue, std::string name)
+            : id_(id), queue_(std::move(queue)), name_(std::move(name)) {
+        }
+
+        SubscriptionId id() const override { return id_; }
+
+        void push(const std::shared_ptr<AVFrame> &frame, const int64_t pts, uint64_t) override {
+            queue_->push(frame, pts);
+        }
+
+        // 消费者可能还在 popFor 里等待，关闭队列让它返回
+        void stop() override {
+            queue_->close();
+        }
+
+        SubscriberStats stats() const override {
+            SubscriberStats stats;
+            stats.id = id_;
+            stats.name = name_;
+            stats.queue_capacity = queue_->capacity();
+            stats.queue_depth = queue_->size();
+            stats.frames_delivered = queue_->framesPopped();
+            stats.frames_dropped = queue_->framesDropped();
+            return stats;
+        }
+
+    private:
+        const SubscriptionId id_;
+        const std::shared_ptr<FrameQueue> queue_;
+        const std::string name_;
+    };
+
+    class FrameFanout::StreamEntry final : public Entry {
+    public:
+        StreamEntry(const SubscriptionId id, std::shared_ptr<FrameStream> stream)
+            : id_(id), session_id_(stream->options().session_id), stream_(std::move(stream)) {
+        }
+
+        SubscriptionId id() const override { return id_; }
+
+        // 绑定了会话的流不让其他会话为它解码
+        bool accepts(const uint64_t session_id) const override {
+            return session_id_ == 0 || session_id == session_id_;
+        }
+
+        void push(const std::shared_ptr<AVFrame> &frame, const int64_t pts, const uint64_t session_id) override {
+            if (!accepts(session_id)) return;
+            stream_->push(frame, pts, session_id);
+        }
+
+        void sessionEnded(const uint64_t session_id) override {
+            if (session_id_ != 0 && session_id == session_id_) {
+                stream_->close();
+            }
+        }
+
+        void stop() override {
+            stream_->close();
+        }
+
+        SubscriberStats stats() const override {
+            SubscriberStats stats;
+            stats.id = id_;
+            stats.name = stream_->options().name;
+            stats.queue_capacity = std::max<size_t>(stream_->options().capacity, 1);
+            stats.queue_depth = stream_->size();
+            stats.frames_delivered = stream_->framesResumed();
+            stats.frames_dropped = stream_->framesDropped();
+            return stats;
+        }
+
+    private:
+        const SubscriptionId id_;
+        const uint64_t session_id_;
+        const std::shared_ptr<FrameStream> stream_;
+    };
+
+    FrameFanout::~FrameFanout() {
+        std::shared_ptr<const List> subscribers;
+        {
+            std::lock_guard lock(mutex_);
+            subscribers = std::move(subscribers_);
+            count_.store(0, std::memory_order_release);
+        }
+        for (const auto &subscriber: *subscribers) {
+            subscriber->stop();
+        }
+    }
+
+    SubscriptionId FrameFanout::subscribe(AVFrameCallback callback, SubscriberOptions options) {
+        std::lock_guard lock(mutex_);
+        const SubscriptionId id = next_id_++;
+        auto subscriber = std::make_shared<Subscriber>(id, std::move(callback), std::move(options));
+        Subscriber::start(subscriber);
+        insertLocked(std::move(subscriber));
+        return id;
+    }
+
+    SubscriptionId FrameFanout::subscribe(std::shared_ptr<FrameQueue> queue, std::string name) {
+        std::lock_guard lock(mutex_);
+        const SubscriptionId id = next_id_++;
+        insertLocked(std::make_shared<QueueEntry>(id, std::move(queue), std::move(name)));
+        return id;
+    }
+
+    SubscriptionId FrameFanout::subscribe(std::shared_ptr<FrameStream> stream) {
+        std::lock_guard lock(mutex_);
+        const SubscriptionId id = next_id_++;
+        insertLocked(std::make_shared<StreamEntry>(id, std::move(stream)));
+        return id;
+    }
+
+    void FrameFanout::insertLocked(std::shared_ptr<Entry> entry) {
+        auto list = std::make_shared<List>(*subscribers_);
+        list->push_back(std::move(entry));
+        count_.store(list->size(), std::memory_order_release);
+        subscribers_ = std::move(list);
+        version_.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    void FrameFanout::unsubscribe(const SubscriptionId id) {
+        std::shared_ptr<Entry> removed;
+        {
+            std::lock_guard lock(mutex_);
+            auto list = std::make_shared<List>(*subscribers_);
+            const auto it = std::find_if(list->begin(), list->end(),
+                                         [id](const auto &s) { return s->id() == id; });
+            if (it == list->end()) return;
+            removed = std::move(*it);
+            list->erase(it);
+            count_.store(list->size(), std::memory_order_release);
+            subscribers_ = std::move(list);
+            version_.fetch_add(1, std::memory_order_acq_rel);
+        }
+        // 在锁外等待线程退出，它的回调可能正在调用 subscriberStats 等接口
+        removed->stop();
+    }
+
+    bool FrameFanout::wants(const uint64_t session_id) const {
+        std::shared_ptr<const List> subscribers;
+        {
+            std::lock_guard lock(mutex_);
+            subscribers = subscribers_;
+        }
+        return std::any_of(subscribers->begin(), subscribers->end(),
+                           [session_id](const auto &s) { return s->accepts(session_id); });
+    }
+
+    void FrameFanout::publish(const std::shared_ptr<AVFrame> &frame, const int64_t pts,
+                              const uint64_t session_id) const {
+        std::shared_ptr<const List> subscribers;
+        {
+            std::lock_guard lock(mutex_);
+            subscribers = subscribers_;
+        }
+        for (const auto &subscriber: *subscribers) {
+            subscriber->push(frame, pts, session_id);
+        }
+    }
+
+    void FrameFanout::endSession(const uint64_t session_id) const {
+        std::shared_ptr<const List> subscribers;
+        {
+            std::lock_guard lock(mutex_);
+            subscribers = subscribers_;
+        }
+        for (const auto &subscriber: *subscribers) {
+            subscriber->sessionEnded(session_id);
+        }
+    }
+
+    std::vector<SubscriberStats> FrameFanout::stats() const {
+        std::shared_ptr<const List> subscribers;
+        {
+            std::lock_guard lock(mutex_);
+            subscribers = subscribers_;
+        }
+        std::vector<SubscriberStats> stats;
+        stats.reserve(subscribers->size());
+        for (const auto &subscriber: *subscribers) {
+            stats.push_back(subscriber->stats());
+        }
+        return stats;
+    }
+} // namespace airplay_streamer
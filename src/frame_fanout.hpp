@@ -0,0 +1,69 @@
+// src/frame_fanout.hpp
+#pragma once
+
+#include <airplay_streamer.hpp>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ender::airplay_streamer {
+    // 一路解码结果分发给多个订阅者。每个订阅者有自己的有界队列和回调线程，
+    // publish 只做入队，满了按订阅者的策略丢帧，慢订阅者不会拖住解码线程或其他订阅者。
+    // 帧以 shared_ptr 共享，不复制像素
+    class FrameFanout {
+    public:
+        FrameFanout() = default;
+
+        ~FrameFanout();
+
+        FrameFanout(const FrameFanout &) = delete;
+
+        FrameFanout &operator=(const FrameFanout &) = delete;
+
+        SubscriptionId subscribe(AVFrameCallback callback, SubscriberOptions options);
+
+        // 调用方拉取的队列，publish 直接推进去，不需要线程
+        SubscriptionId subscribe(std::shared_ptr<FrameQueue> queue, std::string name);
+
+        // 协程帧流，帧推进去时直接恢复等待中的协程
+        SubscriptionId subscribe(std::shared_ptr<FrameStream> stream);
+
+        // 停止订阅者并等待回调线程退出（队列订阅者则关闭队列）；在它自己的回调里调用时不等待
+        void unsubscribe(SubscriptionId id);
+
+        bool empty() const { return count_.load(std::memory_order_acquire) == 0; }
+
+        // 订阅者列表每变一次加一，会话据此判断要不要重新调用 wants
+        uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+        // 是否有订阅者会收到 session_id 的帧，决定这个会话要不要解码
+        bool wants(uint64_t session_id) const;
+
+        // 在解码 / delivery 线程上调用，不阻塞（没有执行器的帧流会在这里恢复协程）
+        void publish(const std::shared_ptr<AVFrame> &frame, int64_t pts, uint64_t session_id) const;
+
+        // 会话结束时调用，关闭只接收这个会话的帧流
+        void endSession(uint64_t session_id) const;
+
+        std::vector<SubscriberStats> stats() const;
+
+    private:
+        class Entry;
+        class Subscriber;
+        class QueueEntry;
+        class StreamEntry;
+        using List = std::vector<std::shared_ptr<Entry>>;
+
+        // 调用时持有 mutex_
+        void insertLocked(std::shared_ptr<Entry> entry);
+
+        // 订阅者列表写时复制，publish 只需在锁内拷贝一个 shared_ptr
+        mutable std::mutex mutex_;
+        std::shared_ptr<const List> subscribers_ = std::make_shared<const List>();
+        std::atomic<size_t> count_{0};
+        std::atomic<uint64_t> version_{0};
+        SubscriptionId next_id_ = 1;
+    };
+} // namespace airplay_streamer
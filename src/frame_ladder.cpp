@@ -0,0 +1,172 @@
+// src/frame_ladder.cpp
+
+#include "frame_ladder.hpp"
+#include "frame_pool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AIRPLAY_LADDER_SSE2 1
+#endif
+
+extern "C" {
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+}
+
+namespace ender::airplay_streamer {
+    namespace {
+        constexpr int kAlign = 64;
+        constexpr int kMaxLevels = 6;
+
+        // 两行源像素 2x2 取平均得到一行，dst_width = (src_width + 1) / 2
+        void halveRow(const uint8_t *s0, const uint8_t *s1, uint8_t *dst, const int src_width, const int dst_width) {
+            int x = 0;
+#ifdef AIRPLAY_LADDER_SSE2
+            // 四个像素在 16 位里求和后统一 (sum + 2) >> 2，与标量尾部逐位一致；
+            // 两次 _mm_avg_epu8 会各向上舍入一次，结果随宽度落在哪条路径上差 1
+            const __m128i mask = _mm_set1_epi16(0x00ff);
+            const __m128i two = _mm_set1_epi16(2);
+            const auto pairSums = [&mask](const __m128i v) {
+                return _mm_add_epi16(_mm_and_si128(v, mask), _mm_srli_epi16(v, 8));
+            };
+            for (; x + 16 <= dst_width && 2 * x + 32 <= src_width; x += 16) {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s0 + 2 * x));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s0 + 2 * x + 16));
+                const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s1 + 2 * x));
+                const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s1 + 2 * x + 16));
+                const __m128i h0 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(pairSums(a), pairSums(c)), two), 2);
+                const __m128i h1 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(pairSums(b), pairSums(d)), two), 2);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(h0, h1));
+            }
+#endif
+            for (; x < dst_width; ++x) {
+                const int x0 = 2 * x;
+                const int x1 = std::min(x0 + 1, src_width - 1);
+                dst[x] = static_cast<uint8_t>((s0[x0] + s0[x1] + s1[x0] + s1[x1] + 2) >> 2);
+            }
+        }
+    }
+
+    FrameLadder::FrameLadder(std::shared_ptr<FramePool> frame_pool, const std::vector<int> &divisors)
+        : frame_pool_(std::move(frame_pool)) {
+        scratch_ = av_frame_alloc();
+        if (!scratch_) {
+            throw std::runtime_error("Failed to allocate ladder frame.");
+        }
+        int max_level = 0;
+        for (const int divisor: divisors) {
+            if (divisor <= 0 || !std::has_single_bit(static_cast<unsigned>(divisor))) continue;
+            const int level = std::countr_zero(static_cast<unsigned>(divisor));
+            if (level > kMaxLevels) continue;
+            requested_.push_back(level);
+            max_level = std::max(max_level, level);
+        }
+        levels_.resize(max_level);
+        frames_.reserve(levels_.size() + 1);
+        planes_.reserve(levels_.size() + 1);
+    }
+
+    FrameLadder::~FrameLadder() {
+        av_frame_free(&scratch_);
+        for (Level &level: levels_) {
+            av_buffer_pool_uninit(&level.pool);
+        }
+    }
+
+    std::shared_ptr<AVFrame> FrameLadder::allocLevel(Level &level, const AVFrame *src, const int width,
+                                                     const int height) {
+        const auto format = static_cast<AVPixelFormat>(src->format);
+        if (!level.pool || level.width != width || level.height != height) {
+            // 分辨率变化，旧池里还在用户手里的缓冲归还时才释放
+            av_buffer_pool_uninit(&level.pool);
+            level.buffer_size = paddedImageSize(format, width, height, kAlign);
+            level.pool = av_buffer_pool_init(level.buffer_size, av_buffer_alloc);
+            level.width = width;
+            level.height = height;
+            if (!level.pool) return nullptr;
+        }
+
+        scratch_->buf[0] = av_buffer_pool_get(level.pool);
+        if (!scratch_->buf[0]) return nullptr;
+        scratch_->format = format;
+        scratch_->width = width;
+        scratch_->height = height;
+        av_image_fill_arrays(scratch_->data, scratch_->linesize, scratch_->buf[0]->data, format, width, height,
+                             kAlign);
+        av_frame_copy_props(scratch_, src);
+        return frame_pool_->wrap(scratch_);
+    }
+
+    void FrameLadder::cascade(const std::vector<Plane> &planes, const size_t k, const int row) {
+        if (k + 1 >= planes.size()) return;
+        const Plane &src = planes[k];
+        if ((row & 1) == 0 && row != src.height - 1) return;
+
+        const Plane &dst = planes[k + 1];
+        const int dst_row = row >> 1;
+        const int r0 = dst_row * 2;
+        const int r1 = std::min(r0 + 1, src.height - 1);
+        halveRow(src.data + static_cast<ptrdiff_t>(r0) * src.linesize,
+                 src.data + static_cast<ptrdiff_t>(r1) * src.linesize,
+                 dst.data + static_cast<ptrdiff_t>(dst_row) * dst.linesize, src.width, dst.width);
+        cascade(planes, k + 1, dst_row);
+    }
+
+    bool FrameLadder::build(const std::shared_ptr<AVFrame> &src, std::vector<std::shared_ptr<AVFrame>> &out) {
+        out.clear();
+        if (!src || (src->format != AV_PIX_FMT_YUV420P && src->format != AV_PIX_FMT_YUVJ420P)) return false;
+
+        // 先分配所有级（中间级即使没被请求也要作为下一级的输入）
+        frames_.clear();
+        frames_.push_back(src);
+        int width = src->width;
+        int height = src->height;
+        for (size_t k = 1; k <= levels_.size(); ++k) {
+            width = (width + 1) >> 1;
+            height = (height + 1) >> 1;
+            auto frame = allocLevel(levels_[k - 1], src.get(), width, height);
+            if (!frame) {
+                frames_.clear();
+                return false;
+            }
+            frames_.push_back(std::move(frame));
+        }
+
+        // 三个平面分别按行流水生成所有级
+        for (int p = 0; p < 3; ++p) {
+            const int shift = p == 0 ? 0 : 1;
+            planes_.clear();
+            for (const auto &frame: frames_) {
+                planes_.push_back({frame->data[p], frame->linesize[p],
+                                   (frame->width + shift) >> shift, (frame->height + shift) >> shift});
+            }
+            for (int row = 0; row < planes_[0].height; ++row) {
+                cascade(planes_, 0, row);
+            }
+        }
+
+        out.reserve(requested_.size());
+        for (const int level: requested_) {
+            if (level > 0) {
+                out.push_back(frames_[level]);
+                continue;
+            }
+            // 原尺寸也给一个独立的外壳，源帧之后挂 FrameExtras 时不会自己引用自己
+            auto ref = frame_pool_->share(src.get());
+            if (!ref) {
+                out.clear();
+                frames_.clear();
+                return false;
+            }
+            out.push_back(std::move(ref));
+        }
+        // 不留引用：各级的生命周期只由 out 决定
+        frames_.clear();
+        return true;
+    }
+} // namespace airplay_streamer
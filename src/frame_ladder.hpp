@@ -0,0 +1,63 @@
+// src/frame_ladder.hpp
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct AVBufferPool;
+struct AVFrame;
+
+namespace ender::airplay_streamer {
+    class FramePool;
+
+    // 从一帧 yuv420p 生成 1/2、1/4 ... 的缩小帧。
+    // 按行流水处理：源图每生成两行 1/2 行就立即生成一行 1/4，数据还在缓存里时用完；
+    // 每一级的输出缓冲来自各自的 AVBufferPool，AVFrame 外壳和控制块来自 frame_pool。只在一个线程上使用
+    class FrameLadder {
+    public:
+        // divisors 为 2 的幂（1 表示原尺寸，输出一个引用源帧缓冲的新 AVFrame）；其余的值被忽略
+        FrameLadder(std::shared_ptr<FramePool> frame_pool, const std::vector<int> &divisors);
+
+        ~FrameLadder();
+
+        FrameLadder(const FrameLadder &) = delete;
+
+        FrameLadder &operator=(const FrameLadder &) = delete;
+
+        bool empty() const { return requested_.empty(); }
+
+        // 按构造时 divisors 的顺序输出各级；源格式不是 yuv420p 时返回 false
+        bool build(const std::shared_ptr<AVFrame> &src, std::vector<std::shared_ptr<AVFrame>> &out);
+
+    private:
+        struct Level {
+            AVBufferPool *pool = nullptr;
+            int width = 0;
+            int height = 0;
+            int buffer_size = 0;
+        };
+
+        struct Plane {
+            uint8_t *data;
+            int linesize;
+            int width;
+            int height;
+        };
+
+        std::shared_ptr<AVFrame> allocLevel(Level &level, const AVFrame *src, int width, int height);
+
+        // 行流水：第 k 级的第 row 行写完后，如果凑够了两行就继续生成第 k+1 级的一行
+        static void cascade(const std::vector<Plane> &planes, size_t k, int row);
+
+        std::shared_ptr<FramePool> frame_pool_;
+        AVFrame *scratch_ = nullptr; // 填好一级后由 frame_pool_->wrap() 移走引用
+
+        std::vector<int> requested_; // 每个输出对应的级数，0 为原尺寸
+        std::vector<Level> levels_;  // levels_[k - 1] 为 1/2^k
+
+        // build() 每帧复用的临时数组
+        std::vector<std::shared_ptr<AVFrame>> frames_;
+        std::vector<Plane> planes_;
+    };
+} // namespace airplay_streamer
@@ -0,0 +1,63 @@
+// src/frame_mailbox.hpp
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+struct AVFrame;
+
+namespace ender::airplay_streamer {
+    // 只有一个槽位的帧信箱：新帧直接覆盖还没被取走的旧帧，
+    // 消费者每次拿到的都是最新的一帧。一个生产者、一个消费者
+    class FrameMailbox {
+    public:
+        FrameMailbox() = default;
+
+        FrameMailbox(const FrameMailbox &) = delete;
+
+        FrameMailbox &operator=(const FrameMailbox &) = delete;
+
+        // 放入一帧，覆盖了未取走的旧帧时返回 true
+        bool put(std::shared_ptr<AVFrame> frame, const int64_t pts) {
+            std::shared_ptr<AVFrame> stale;
+            {
+                std::lock_guard lock(mutex_);
+                stale = std::move(frame_);
+                frame_ = std::move(frame);
+                pts_ = pts;
+            }
+            cv_.notify_one();
+            // 旧帧在锁外释放，归还帧池时不占着信箱
+            return stale != nullptr;
+        }
+
+        // 阻塞直到有新帧；close 之后返回 false
+        bool take(std::shared_ptr<AVFrame> &frame, int64_t &pts) {
+            std::unique_lock lock(mutex_);
+            cv_.wait(lock, [this] { return frame_ || closed_; });
+            if (closed_) return false;
+            frame = std::move(frame_);
+            pts = pts_;
+            return true;
+        }
+
+        void close() {
+            std::shared_ptr<AVFrame> stale;
+            {
+                std::lock_guard lock(mutex_);
+                closed_ = true;
+                stale = std::move(frame_);
+            }
+            cv_.notify_all();
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::shared_ptr<AVFrame> frame_;
+        int64_t pts_ = 0;
+        bool closed_ = false;
+    };
+} // namespace airplay_streamer
@@ -0,0 +1,260 @@
+// src/frame_pool.cpp
+
+#include "frame_pool.hpp"
+
+#include <algorithm>
+#include <new>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+}
+
+namespace ender::airplay_streamer {
+    namespace {
+        constexpr int kPlaneAlign = 64;
+        // 不经过 libavcodec 分配时尺寸按宏块对齐，和 H.264 解码器的对齐一致
+        constexpr int kDimensionAlign = 32;
+    }
+
+    // shared_ptr 控制块的分配器，从 FramePool 的空闲链表里取块。
+    // 控制块里保存的分配器副本持有池的引用，保证块释放前池一直存在
+    template<typename T>
+    class PoolAllocator {
+    public:
+        using value_type = T;
+
+        explicit PoolAllocator(std::shared_ptr<FramePool> pool) : pool_(std::move(pool)) {
+        }
+
+        template<typename U>
+        PoolAllocator(const PoolAllocator<U> &other) : pool_(other.pool_) {
+        }
+
+        T *allocate(const size_t n) {
+            return static_cast<T *>(pool_->allocateBlock(n * sizeof(T)));
+        }
+
+        void deallocate(T *p, const size_t n) {
+            pool_->deallocateBlock(p, n * sizeof(T));
+        }
+
+        template<typename U>
+        bool operator==(const PoolAllocator<U> &other) const { return pool_ == other.pool_; }
+
+    private:
+        template<typename U>
+        friend class PoolAllocator;
+
+        std::shared_ptr<FramePool> pool_;
+    };
+
+    int paddedImageSize(const int format, const int width, const int height, const int align) {
+        const int size = av_image_get_buffer_size(static_cast<AVPixelFormat>(format), width, height, align);
+        return size < 0 ? size : size + kFramePadding;
+    }
+
+    std::shared_ptr<FramePool> FramePool::create() {
+        return std::shared_ptr<FramePool>(new FramePool());
+    }
+
+    FramePool::~FramePool() {
+        // 还在用户手里的缓冲会在最后一次 unref 时随池一起释放
+        av_buffer_pool_uninit(&buffer_pool_);
+        for (AVFrame *frame: shells_) {
+            av_frame_free(&frame);
+        }
+        for (void *block: blocks_) {
+            ::operator delete(block);
+        }
+    }
+
+    bool FramePool::Layout::operator==(const Layout &other) const {
+        // 只比较几何布局：YUV420P 和 YUVJ420P、对齐前后不同但对齐后相同的尺寸可以共用一个池
+        return std::equal(linesize, linesize + 3, other.linesize) && size == other.size;
+    }
+
+    void FramePool::attach(AVCodecContext *ctx) {
+        ctx->opaque = this;
+        ctx->get_buffer2 = &FramePool::getBuffer;
+    }
+
+    int FramePool::getBuffer(AVCodecContext *ctx, AVFrame *frame, const int flags) {
+        auto *pool = static_cast<FramePool *>(ctx->opaque);
+        if (!pool || (frame->format != AV_PIX_FMT_YUV420P && frame->format != AV_PIX_FMT_YUVJ420P)) {
+            return avcodec_default_get_buffer2(ctx, frame, flags);
+        }
+        return pool->allocBuffer(ctx, frame);
+    }
+
+    FramePool::Layout FramePool::computeLayout(AVCodecContext *ctx, int width, int height) {
+        int linesize_align[AV_NUM_DATA_POINTERS];
+        avcodec_align_dimensions2(ctx, &width, &height, linesize_align);
+        return planeLayout(width, height, linesize_align);
+    }
+
+    FramePool::Layout FramePool::planeLayout(const int width, const int height, const int *linesize_align) {
+        Layout layout;
+        // 三个平面放在同一块缓冲里，每个平面起始地址和行宽都按 64 字节对齐，方便后续 SIMD 处理
+        const int plane_width[3] = {width, (width + 1) >> 1, (width + 1) >> 1};
+        const int plane_height[3] = {height, (height + 1) >> 1, (height + 1) >> 1};
+        size_t offset = 0;
+        for (int i = 0; i < 3; ++i) {
+            const int align = std::max(kPlaneAlign, linesize_align[i]);
+            layout.linesize[i] = FFALIGN(plane_width[i], align);
+            layout.offset[i] = offset;
+            offset += FFALIGN(static_cast<size_t>(layout.linesize[i]) * plane_height[i], kPlaneAlign);
+        }
+        layout.size = offset + kFramePadding;
+        return layout;
+    }
+
+    void FramePool::resetPoolLocked(const Layout &layout) {
+        if (buffer_pool_ && layout == layout_) return;
+
+        // 分辨率变化，旧池里未归还的缓冲仍然有效，归还时才真正释放
+        av_buffer_pool_uninit(&buffer_pool_);
+        buffer_pool_ = av_buffer_pool_init(layout.size, av_buffer_alloc);
+        layout_ = layout;
+    }
+
+    void FramePool::reserve(AVCodecContext *ctx, const int width, const int height, const int count) {
+        if (width <= 0 || height <= 0 || count <= 0) return;
+
+        // 还没解码过时 pix_fmt 未知，按 AirPlay 实际输出的 YUV420P 计算对齐
+        const AVPixelFormat pix_fmt = ctx->pix_fmt;
+        if (pix_fmt == AV_PIX_FMT_NONE) ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+        const Layout layout = computeLayout(ctx, width, height);
+        ctx->pix_fmt = pix_fmt;
+
+        std::vector<AVBufferRef *> buffers;
+        buffers.reserve(count);
+        {
+            std::lock_guard lock(buffer_mutex_);
+            resetPoolLocked(layout);
+            if (!buffer_pool_) return;
+            for (int i = 0; i < count; ++i) {
+                if (AVBufferRef *buffer = av_buffer_pool_get(buffer_pool_)) {
+                    buffers.push_back(buffer);
+                }
+            }
+        }
+        // 全部归还，池里就有了 count 块空闲缓冲
+        for (AVBufferRef *buffer: buffers) {
+            av_buffer_unref(&buffer);
+        }
+    }
+
+    int FramePool::allocate(AVFrame *frame) {
+        if (frame->width <= 0 || frame->height <= 0) return AVERROR(EINVAL);
+        if (frame->format != AV_PIX_FMT_YUV420P && frame->format != AV_PIX_FMT_YUVJ420P) {
+            return av_frame_get_buffer(frame, 0);
+        }
+        constexpr int linesize_align[3] = {kPlaneAlign, kPlaneAlign, kPlaneAlign};
+        return allocLayout(planeLayout(FFALIGN(frame->width, kDimensionAlign), FFALIGN(frame->height, kDimensionAlign),
+                                       linesize_align), frame);
+    }
+
+    int FramePool::allocBuffer(AVCodecContext *ctx, AVFrame *frame) {
+        return allocLayout(computeLayout(ctx, frame->width, frame->height), frame);
+    }
+
+    int FramePool::allocLayout(const Layout &layout, AVFrame *frame) {
+        AVBufferRef *buffer = nullptr;
+        {
+            std::lock_guard lock(buffer_mutex_);
+            resetPoolLocked(layout);
+            if (buffer_pool_) {
+                buffer = av_buffer_pool_get(buffer_pool_);
+            }
+        }
+        if (!buffer) {
+            return AVERROR(ENOMEM);
+        }
+
+        frame->buf[0] = buffer;
+        for (int i = 0; i < 3; ++i) {
+            frame->data[i] = buffer->data + layout.offset[i];
+            frame->linesize[i] = layout.linesize[i];
+        }
+        frame->extended_data = frame->data;
+        return 0;
+    }
+
+    std::shared_ptr<AVFrame> FramePool::wrap(AVFrame *src) {
+        AVFrame *shell = acquireShell();
+        if (!shell) {
+            av_frame_unref(src);
+            return nullptr;
+        }
+        av_frame_move_ref(shell, src);
+        return {shell, Recycler{this}, PoolAllocator<AVFrame>(shared_from_this())};
+    }
+
+    std::shared_ptr<AVFrame> FramePool::share(const AVFrame *src) {
+        AVFrame *shell = acquireShell();
+        if (!shell) return nullptr;
+        if (av_frame_ref(shell, src) < 0) {
+            recycleShell(shell);
+            return nullptr;
+        }
+        return {shell, Recycler{this}, PoolAllocator<AVFrame>(shared_from_this())};
+    }
+
+    void FramePool::Recycler::operator()(AVFrame *frame) const {
+        pool->recycleShell(frame);
+    }
+
+    AVFrame *FramePool::acquireShell() {
+        {
+            std::lock_guard lock(cache_mutex_);
+            if (!shells_.empty()) {
+                AVFrame *frame = shells_.back();
+                shells_.pop_back();
+                return frame;
+            }
+        }
+        return av_frame_alloc();
+    }
+
+    void FramePool::recycleShell(AVFrame *frame) {
+        // 像素缓冲在这里归还给 AVBufferPool
+        av_frame_unref(frame);
+        {
+            std::lock_guard lock(cache_mutex_);
+            if (shells_.size() < kMaxCached) {
+                shells_.push_back(frame);
+                return;
+            }
+        }
+        av_frame_free(&frame);
+    }
+
+    void *FramePool::allocateBlock(const size_t size) {
+        if (size <= kBlockSize) {
+            {
+                std::lock_guard lock(cache_mutex_);
+                if (!blocks_.empty()) {
+                    void *block = blocks_.back();
+                    blocks_.pop_back();
+                    return block;
+                }
+            }
+            return ::operator new(kBlockSize);
+        }
+        return ::operator new(size);
+    }
+
+    void FramePool::deallocateBlock(void *block, const size_t size) {
+        if (size <= kBlockSize) {
+            std::lock_guard lock(cache_mutex_);
+            if (blocks_.size() < kMaxCached) {
+                blocks_.push_back(block);
+                return;
+            }
+        }
+        ::operator delete(block);
+    }
+} // namespace airplay_streamer
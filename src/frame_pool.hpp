@@ -0,0 +1,105 @@
+// src/frame_pool.hpp
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct AVBufferPool;
+struct AVCodecContext;
+struct AVFrame;
+
+namespace ender::airplay_streamer {
+    // 库内分配的像素缓冲末尾都多留这么多字节，允许 SIMD 代码越界读几个字节
+    constexpr int kFramePadding = 64;
+
+    // av_image_get_buffer_size 加上 kFramePadding；失败返回负的 AVERROR
+    int paddedImageSize(int format, int width, int height, int align);
+
+    // 解码输出帧的对象池：
+    //  - 像素数据来自按分辨率建立的 AVBufferPool（作为解码器的 get_buffer2）
+    //  - 交给用户的 AVFrame 外壳和 shared_ptr 控制块都会回收复用
+    // 最后一个 shared_ptr 释放时帧回到池中，稳态解码不再逐帧申请堆内存
+    class FramePool : public std::enable_shared_from_this<FramePool> {
+    public:
+        static std::shared_ptr<FramePool> create();
+
+        ~FramePool();
+
+        FramePool(const FramePool &) = delete;
+
+        FramePool &operator=(const FramePool &) = delete;
+
+        // 让解码器从本池分配帧缓冲；对已经打开的解码器也可以调用（例如从 DecoderPool 取出的）
+        void attach(AVCodecContext *ctx);
+
+        // 按即将解码的分辨率预先建好缓冲池并分配 count 块缓冲，避免新分辨率的前几帧现场申请内存。
+        // ctx 必须是已经 attach 过的解码器
+        void reserve(AVCodecContext *ctx, int width, int height, int count);
+
+        // 给不经过 libavcodec 的解码器用：按 frame 的 width / height / format 分配缓冲，
+        // YUV420P 从池里取，其他格式走 av_frame_get_buffer；失败返回负的 AVERROR
+        int allocate(AVFrame *frame);
+
+        // 把 src 的引用移入一个池化的 AVFrame 并包装成 shared_ptr，src 被清空
+        std::shared_ptr<AVFrame> wrap(AVFrame *src);
+
+        // 给 src 新建一个引用放进池化的 AVFrame，src 不变；失败返回 nullptr
+        std::shared_ptr<AVFrame> share(const AVFrame *src);
+
+    private:
+        template<typename T>
+        friend class PoolAllocator;
+
+        struct Recycler {
+            FramePool *pool;
+
+            void operator()(AVFrame *frame) const;
+        };
+
+        struct Layout {
+            int linesize[4] = {};
+            size_t offset[4] = {};
+            size_t size = 0;
+
+            bool operator==(const Layout &other) const;
+        };
+
+        FramePool() = default;
+
+        static int getBuffer(AVCodecContext *ctx, AVFrame *frame, int flags);
+
+        static Layout computeLayout(AVCodecContext *ctx, int width, int height);
+
+        // width / height 为已经对齐过的尺寸
+        static Layout planeLayout(int width, int height, const int *linesize_align);
+
+        // 调用方持有 buffer_mutex_，布局变化时重建缓冲池
+        void resetPoolLocked(const Layout &layout);
+
+        int allocBuffer(AVCodecContext *ctx, AVFrame *frame);
+
+        int allocLayout(const Layout &layout, AVFrame *frame);
+
+        AVFrame *acquireShell();
+
+        void recycleShell(AVFrame *frame);
+
+        void *allocateBlock(size_t size);
+
+        void deallocateBlock(void *block, size_t size);
+
+        // shared_ptr 控制块的固定大小，超过的走普通 new
+        static constexpr size_t kBlockSize = 128;
+        static constexpr size_t kMaxCached = 64;
+
+        std::mutex buffer_mutex_;
+        AVBufferPool *buffer_pool_ = nullptr;
+        Layout layout_;
+
+        std::mutex cache_mutex_;
+        std::vector<AVFrame *> shells_;
+        std::vector<void *> blocks_;
+    };
+} // namespace airplay_streamer
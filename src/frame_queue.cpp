@@ -0,0 +1,116 @@
+// src/frame_queue.cpp
+
+#include <frame_queue.hpp>
+#include "mpmc_queue.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace ender::airplay_streamer {
+    class FrameQueue::Impl {
+    public:
+        Impl(const size_t capacity, const DropPolicy drop_policy) : ring(capacity), drop_policy(drop_policy) {
+        }
+
+        MpmcQueue<QueuedFrame> ring;
+        const DropPolicy drop_policy;
+
+        std::atomic<bool> closed{false};
+        std::atomic<uint64_t> popped{0};
+        std::atomic<uint64_t> dropped{0};
+
+        // 只在 popFor 睡眠时使用；生产者看到有人在等才去碰锁
+        std::atomic<int> waiters{0};
+        std::mutex mutex;
+        std::condition_variable cv;
+
+        void wake() {
+            // 与 popFor 中 waiters 自增后的栅栏配对：要么消费者在睡前看到新帧，要么这里看到等待者
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (waiters.load(std::memory_order_relaxed) == 0) return;
+            {
+                std::lock_guard lock(mutex);
+            }
+            cv.notify_all();
+        }
+    };
+
+    FrameQueue::FrameQueue(const size_t capacity, const DropPolicy drop_policy)
+        : impl_(std::make_unique<Impl>(capacity, drop_policy)) {
+    }
+
+    FrameQueue::~FrameQueue() = default;
+
+    bool FrameQueue::push(std::shared_ptr<AVFrame> frame, const int64_t pts) {
+        if (impl_->closed.load(std::memory_order_acquire)) return false;
+        QueuedFrame item{std::move(frame), pts};
+        while (!impl_->ring.tryPush(item)) {
+            if (impl_->drop_policy == DropPolicy::DropNewest) {
+                impl_->dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            // 从队头丢一帧腾出位置；被消费者抢先取走时直接重试
+            if (QueuedFrame oldest; impl_->ring.tryPop(oldest)) {
+                impl_->dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        impl_->wake();
+        return true;
+    }
+
+    bool FrameQueue::tryPop(QueuedFrame &out) {
+        if (!impl_->ring.tryPop(out)) return false;
+        impl_->popped.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool FrameQueue::popFor(QueuedFrame &out, const std::chrono::microseconds timeout) {
+        if (tryPop(out)) return true;
+        if (timeout <= std::chrono::microseconds::zero()) return false;
+
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        impl_->waiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool popped = false;
+        {
+            std::unique_lock lock(impl_->mutex);
+            impl_->cv.wait_until(lock, deadline, [&] {
+                popped = tryPop(out);
+                return popped || impl_->closed.load(std::memory_order_acquire);
+            });
+        }
+        impl_->waiters.fetch_sub(1, std::memory_order_relaxed);
+        // 关闭时队列里可能还有帧
+        return popped || tryPop(out);
+    }
+
+    void FrameQueue::close() {
+        impl_->closed.store(true, std::memory_order_release);
+        impl_->wake();
+    }
+
+    bool FrameQueue::closed() const {
+        return impl_->closed.load(std::memory_order_acquire);
+    }
+
+    size_t FrameQueue::size() const {
+        return impl_->ring.size();
+    }
+
+    size_t FrameQueue::capacity() const {
+        return impl_->ring.capacity();
+    }
+
+    DropPolicy FrameQueue::dropPolicy() const {
+        return impl_->drop_policy;
+    }
+
+    uint64_t FrameQueue::framesPopped() const {
+        return impl_->popped.load(std::memory_order_relaxed);
+    }
+
+    uint64_t FrameQueue::framesDropped() const {
+        return impl_->dropped.load(std::memory_order_relaxed);
+    }
+} // namespace airplay_streamer
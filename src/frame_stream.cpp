@@ -0,0 +1,140 @@
+// src/frame_stream.cpp
+
+#include <frame_stream.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace ender::airplay_streamer {
+    // 一个流只有一个消费者，而且消费者大部分时间挂起，锁只在推送和取帧的瞬间持有
+    class FrameStream::Impl {
+    public:
+        explicit Impl(FrameStreamOptions options)
+            : options(std::move(options)), ring(std::max<size_t>(this->options.capacity, 1)) {
+        }
+
+        const FrameStreamOptions options;
+
+        mutable std::mutex mutex;
+        std::vector<StreamedFrame> ring;
+        size_t head = 0;
+        size_t size = 0;
+        bool closed = false;
+
+        // 挂起中的协程和它的结果槽
+        std::coroutine_handle<> waiter;
+        std::optional<StreamedFrame> *slot = nullptr;
+
+        std::atomic<uint64_t> resumed{0};
+        std::atomic<uint64_t> dropped{0};
+
+        // 调用时持有 mutex
+        bool popLocked(std::optional<StreamedFrame> &out) {
+            if (size == 0) return false;
+            out = std::move(ring[head]);
+            head = (head + 1) % ring.size();
+            --size;
+            resumed.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        void resume(const std::coroutine_handle<> handle) const {
+            if (options.executor) {
+                options.executor(handle);
+            } else {
+                handle.resume();
+            }
+        }
+    };
+
+    FrameStream::FrameStream(FrameStreamOptions options) : impl_(std::make_unique<Impl>(std::move(options))) {
+    }
+
+    FrameStream::~FrameStream() = default;
+
+    bool FrameStream::push(std::shared_ptr<AVFrame> frame, const int64_t pts, const uint64_t session_id) {
+        std::coroutine_handle<> waiter;
+        {
+            std::lock_guard lock(impl_->mutex);
+            if (impl_->closed) return false;
+            if (impl_->waiter) {
+                // 有协程在等，队列必然为空，帧直接写进它的结果槽
+                *impl_->slot = StreamedFrame{std::move(frame), pts, session_id};
+                waiter = std::exchange(impl_->waiter, nullptr);
+                impl_->slot = nullptr;
+                impl_->resumed.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                auto &ring = impl_->ring;
+                if (impl_->size == ring.size()) {
+                    impl_->dropped.fetch_add(1, std::memory_order_relaxed);
+                    if (impl_->options.drop_policy == DropPolicy::DropNewest) return false;
+                    ring[impl_->head] = StreamedFrame{std::move(frame), pts, session_id};
+                    impl_->head = (impl_->head + 1) % ring.size();
+                    return true;
+                }
+                ring[(impl_->head + impl_->size) % ring.size()] = StreamedFrame{std::move(frame), pts, session_id};
+                ++impl_->size;
+                return true;
+            }
+        }
+        // 在锁外恢复，协程可能马上再次 co_await
+        impl_->resume(waiter);
+        return true;
+    }
+
+    void FrameStream::close() {
+        std::coroutine_handle<> waiter;
+        {
+            std::lock_guard lock(impl_->mutex);
+            if (impl_->closed) return;
+            impl_->closed = true;
+            waiter = std::exchange(impl_->waiter, nullptr);
+            impl_->slot = nullptr;
+        }
+        if (waiter) {
+            impl_->resume(waiter);
+        }
+    }
+
+    bool FrameStream::closed() const {
+        std::lock_guard lock(impl_->mutex);
+        return impl_->closed;
+    }
+
+    const FrameStreamOptions &FrameStream::options() const {
+        return impl_->options;
+    }
+
+    size_t FrameStream::size() const {
+        std::lock_guard lock(impl_->mutex);
+        return impl_->size;
+    }
+
+    uint64_t FrameStream::framesResumed() const {
+        return impl_->resumed.load(std::memory_order_relaxed);
+    }
+
+    uint64_t FrameStream::framesDropped() const {
+        return impl_->dropped.load(std::memory_order_relaxed);
+    }
+
+    bool FrameStream::take(std::optional<StreamedFrame> &out) {
+        std::lock_guard lock(impl_->mutex);
+        return impl_->popLocked(out) || impl_->closed;
+    }
+
+    bool FrameStream::suspend(const std::coroutine_handle<> handle, std::optional<StreamedFrame> &out) {
+        std::lock_guard lock(impl_->mutex);
+        if (impl_->popLocked(out) || impl_->closed) return false;
+        if (impl_->waiter) {
+            throw std::logic_error("FrameStream::next() is already being awaited");
+        }
+        impl_->waiter = handle;
+        impl_->slot = &out;
+        return true;
+    }
+} // namespace airplay_streamer
@@ -0,0 +1,65 @@
+// src/frame_view.cpp
+
+#include "frame_view_access.hpp"
+#include "frame_pool.hpp"
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace ender::airplay_streamer {
+    namespace {
+        PixelFormat fromAvFormat(const int format) {
+            switch (format) {
+                case AV_PIX_FMT_YUV420P:
+                case AV_PIX_FMT_YUVJ420P: return PixelFormat::Yuv420p;
+                case AV_PIX_FMT_NV12: return PixelFormat::Nv12;
+                case AV_PIX_FMT_BGRA: return PixelFormat::Bgra;
+                case AV_PIX_FMT_RGBA: return PixelFormat::Rgba;
+                case AV_PIX_FMT_RGB24: return PixelFormat::Rgb24;
+                case AV_PIX_FMT_BGR24: return PixelFormat::Bgr24;
+                case AV_PIX_FMT_GRAY8: return PixelFormat::Gray8;
+                default: return PixelFormat::Count;
+            }
+        }
+
+        std::shared_ptr<AVFrame> shareFromPool(void *context, const AVFrame *frame) {
+            return static_cast<FramePool *>(context)->share(frame);
+        }
+    }
+
+    void FrameViewAccess::fill(FrameView &view, const AVFrame *frame, const int64_t pts, const uint64_t session_id,
+                               FramePool *pool) {
+        for (int i = 0; i < 4; ++i) {
+            view.data[i] = frame->data[i];
+            view.stride[i] = frame->linesize[i];
+        }
+        view.width = frame->width;
+        view.height = frame->height;
+        view.format = fromAvFormat(frame->format);
+        view.native_format = frame->format;
+        view.full_range = frame->color_range == AVCOL_RANGE_JPEG || frame->format == AV_PIX_FMT_YUVJ420P;
+        view.pts = pts;
+        view.session_id = session_id;
+        view.frame_ = frame;
+        view.share_ = pool ? &shareFromPool : nullptr;
+        view.share_context_ = pool;
+        view.owned_.reset();
+    }
+
+    std::shared_ptr<const FrameView> FrameView::retain() const {
+        std::shared_ptr<AVFrame> frame = owned_;
+        if (!frame && frame_ && share_) {
+            frame = share_(share_context_, frame_);
+        }
+        if (!frame) return nullptr;
+
+        // 引用的是同一块缓冲，平面指针保持不变
+        auto view = std::make_shared<FrameView>(*this);
+        view->owned_ = std::move(frame);
+        view->frame_ = view->owned_.get();
+        view->share_ = nullptr;
+        view->share_context_ = nullptr;
+        return view;
+    }
+} // namespace airplay_streamer
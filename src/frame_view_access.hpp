@@ -0,0 +1,16 @@
+// src/frame_view_access.hpp
+#pragma once
+
+#include <frame_view.hpp>
+
+#include <cstdint>
+
+namespace ender::airplay_streamer {
+    class FramePool;
+
+    // 库内部填充 FrameView 的入口
+    struct FrameViewAccess {
+        // 按 frame 填好借用视图，retain() 时从 pool 取帧外壳
+        static void fill(FrameView &view, const AVFrame *frame, int64_t pts, uint64_t session_id, FramePool *pool);
+    };
+} // namespace airplay_streamer
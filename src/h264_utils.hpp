@@ -0,0 +1,120 @@
+// src/h264_utils.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ender::airplay_streamer::h264 {
+    constexpr int kNalSlice = 1;
+    constexpr int kNalIdr = 5;
+    constexpr int kNalSps = 7;
+    constexpr int kNalPps = 8;
+
+    // AirPlay 镜像流里 NAL 前缀固定是 4 字节长度
+    constexpr size_t kAvccLengthSize = 4;
+
+    // 遍历 AVCC（长度前缀）格式的一帧，fn(nal_header_ptr, nal_size)；
+    // 长度越界时返回 false
+    template<typename Fn>
+    bool forEachAvccNal(const uint8_t *data, const size_t size, Fn &&fn) {
+        size_t pos = 0;
+        while (pos + kAvccLengthSize <= size) {
+            const size_t nal_size = static_cast<size_t>(data[pos]) << 24 | static_cast<size_t>(data[pos + 1]) << 16 |
+                                    static_cast<size_t>(data[pos + 2]) << 8 | data[pos + 3];
+            pos += kAvccLengthSize;
+            if (nal_size == 0 || nal_size > size - pos) return false;
+            fn(data + pos, nal_size);
+            pos += nal_size;
+        }
+        return pos == size;
+    }
+
+    inline bool isKeyframeAvcc(const uint8_t *data, const size_t size) {
+        bool keyframe = false;
+        forEachAvccNal(data, size, [&keyframe](const uint8_t *nal, size_t) {
+            if ((nal[0] & 0x1f) == kNalIdr) keyframe = true;
+        });
+        return keyframe;
+    }
+
+    // 是否含有会被后续帧参考的片（nal_ref_idc 不为 0）；不含的帧可以整帧丢掉而不影响之后的解码。
+    // 格式有误时按参考帧处理
+    inline bool isReferenceAvcc(const uint8_t *data, const size_t size) {
+        bool reference = false;
+        const bool valid = forEachAvccNal(data, size, [&reference](const uint8_t *nal, size_t) {
+            const int type = nal[0] & 0x1f;
+            if ((type == kNalSlice || type == kNalIdr) && (nal[0] & 0x60) != 0) reference = true;
+        });
+        return reference || !valid;
+    }
+
+    // 原地把长度前缀替换成 00 00 00 01 起始码；
+    // nal_sizes 不为空时记下每个 NAL 的长度，之后可以用 annexBToAvcc 换回来
+    inline bool avccToAnnexB(uint8_t *data, const size_t size, std::vector<uint32_t> *nal_sizes = nullptr) {
+        if (nal_sizes) nal_sizes->clear();
+        return forEachAvccNal(data, size, [nal_sizes](const uint8_t *nal, const size_t nal_size) {
+            auto *prefix = const_cast<uint8_t *>(nal) - kAvccLengthSize;
+            prefix[0] = 0;
+            prefix[1] = 0;
+            prefix[2] = 0;
+            prefix[3] = 1;
+            if (nal_sizes) nal_sizes->push_back(static_cast<uint32_t>(nal_size));
+        });
+    }
+
+    // avccToAnnexB 的逆操作，按记录的长度写回前缀
+    inline void annexBToAvcc(uint8_t *data, const std::vector<uint32_t> &nal_sizes) {
+        size_t pos = 0;
+        for (const uint32_t nal_size: nal_sizes) {
+            data[pos] = static_cast<uint8_t>(nal_size >> 24);
+            data[pos + 1] = static_cast<uint8_t>(nal_size >> 16);
+            data[pos + 2] = static_cast<uint8_t>(nal_size >> 8);
+            data[pos + 3] = static_cast<uint8_t>(nal_size);
+            pos += kAvccLengthSize + nal_size;
+        }
+    }
+
+    // 流参数集：原始 avcC 记录和等价的 Annex-B SPS/PPS
+    struct AvcConfig {
+        std::vector<uint8_t> avcc;
+        std::vector<uint8_t> annexb;
+        int nal_length_size = 0;
+        int profile = 0; // AVCProfileIndication
+        int level = 0;   // AVCLevelIndication
+    };
+
+    inline bool parseAvcC(const uint8_t *record, const size_t size, AvcConfig &out) {
+        if (size < 7 || record[0] != 1) return false;
+
+        std::vector<uint8_t> annexb;
+        auto append = [&annexb](const uint8_t *nal, const size_t nal_size) {
+            static constexpr uint8_t start_code[4] = {0, 0, 0, 1};
+            annexb.insert(annexb.end(), start_code, start_code + 4);
+            annexb.insert(annexb.end(), nal, nal + nal_size);
+        };
+
+        size_t pos = 5;
+        for (int set = 0; set < 2; ++set) {
+            // 第一轮是 SPS（数量在低 5 位），第二轮是 PPS
+            if (pos >= size) return false;
+            const int count = set == 0 ? record[pos] & 0x1f : record[pos];
+            ++pos;
+            for (int i = 0; i < count; ++i) {
+                if (pos + 2 > size) return false;
+                const size_t nal_size = static_cast<size_t>(record[pos]) << 8 | record[pos + 1];
+                pos += 2;
+                if (nal_size == 0 || nal_size > size - pos) return false;
+                append(record + pos, nal_size);
+                pos += nal_size;
+            }
+        }
+
+        out.avcc.assign(record, record + size);
+        out.annexb = std::move(annexb);
+        out.nal_length_size = (record[4] & 0x03) + 1;
+        out.profile = record[1];
+        out.level = record[3];
+        return true;
+    }
+} // namespace airplay_streamer::h264
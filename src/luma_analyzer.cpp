@@ -0,0 +1,114 @@
+// src/luma_analyzer.cpp
+
+#include "luma_analyzer.hpp"
+#include "yuv_convert.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AIRPLAY_ANALYTICS_SSE2 1
+#endif
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace ender::airplay_streamer {
+    namespace {
+        // 判为黑屏时允许的亮点比例（光标、状态栏小图标）
+        constexpr uint32_t kBlackOutlierDivisor = 100;
+
+        void sumRow(const uint8_t *row, const int width, uint64_t &sum, uint64_t &sum_squares) {
+            int x = 0;
+            uint64_t s = 0;
+            uint64_t sq = 0;
+#ifdef AIRPLAY_ANALYTICS_SSE2
+            // psadbw 求和，pmaddwd 求平方和；32 位累加器每 4096 像素清空一次，不会溢出
+            const __m128i zero = _mm_setzero_si128();
+            while (x + 16 <= width) {
+                __m128i acc_sum = zero;
+                __m128i acc_sq = zero;
+                const int end = std::min(width - 15, x + 4096);
+                for (; x < end; x += 16) {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+                    acc_sum = _mm_add_epi64(acc_sum, _mm_sad_epu8(v, zero));
+                    const __m128i lo = _mm_unpacklo_epi8(v, zero);
+                    const __m128i hi = _mm_unpackhi_epi8(v, zero);
+                    acc_sq = _mm_add_epi32(acc_sq, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+                }
+                alignas(16) uint64_t sums[2];
+                alignas(16) uint32_t squares[4];
+                _mm_store_si128(reinterpret_cast<__m128i *>(sums), acc_sum);
+                _mm_store_si128(reinterpret_cast<__m128i *>(squares), acc_sq);
+                s += sums[0] + sums[1];
+                sq += static_cast<uint64_t>(squares[0]) + squares[1] + squares[2] + squares[3];
+            }
+#endif
+            for (; x < width; ++x) {
+                s += row[x];
+                sq += static_cast<uint32_t>(row[x]) * row[x];
+            }
+            sum = s;
+            sum_squares = sq;
+        }
+    }
+
+    LumaAnalyzer::LumaAnalyzer(const Analytics &policy)
+        : row_step_(std::max(policy.row_step, 1)), column_step_(std::max(policy.column_step, 1)),
+          black_level_(std::clamp(policy.black_level, 0, 255)), blank_variance_(policy.blank_variance) {
+    }
+
+    bool LumaAnalyzer::analyze(const AVFrame *frame, FrameAnalytics &out) {
+        out.computed = false;
+        if (!yuv::hasLumaPlane(frame) || frame->width <= 0 || frame->height <= 0) return false;
+
+        if (frame->width != width_ || frame->height != height_) {
+            width_ = frame->width;
+            height_ = frame->height;
+            previous_.clear();
+        }
+
+        // 四个子直方图交替累加，避免相邻像素落在同一格时的写后读依赖
+        uint32_t partial[4][256] = {};
+        signature_.clear();
+        uint64_t total = 0;
+        uint64_t total_squares = 0;
+        uint32_t samples = 0;
+
+        for (int y = 0; y < height_; y += row_step_) {
+            const uint8_t *row = frame->data[0] + static_cast<ptrdiff_t>(y) * frame->linesize[0];
+            RowSignature signature{};
+            sumRow(row, width_, signature.sum, signature.sum_squares);
+            signature_.push_back(signature);
+            total += signature.sum;
+            total_squares += signature.sum_squares;
+
+            int i = 0;
+            for (int x = 0; x < width_; x += column_step_, ++i) {
+                ++partial[i & 3][row[x]];
+            }
+            samples += static_cast<uint32_t>(i);
+        }
+
+        for (int bin = 0; bin < 256; ++bin) {
+            out.histogram[bin] = partial[0][bin] + partial[1][bin] + partial[2][bin] + partial[3][bin];
+        }
+        out.samples = samples;
+
+        const double pixels = static_cast<double>(signature_.size()) * width_;
+        const double mean = static_cast<double>(total) / pixels;
+        out.mean = static_cast<float>(mean);
+        out.variance = static_cast<float>(std::max(0.0, static_cast<double>(total_squares) / pixels - mean * mean));
+
+        uint32_t dark = 0;
+        for (int bin = 0; bin <= black_level_; ++bin) dark += out.histogram[bin];
+        out.black = samples - dark <= samples / kBlackOutlierDivisor;
+        out.blank = out.variance <= blank_variance_;
+        out.unchanged = !previous_.empty() && previous_ == signature_;
+        out.computed = true;
+
+        signature_.swap(previous_);
+        return true;
+    }
+} // namespace airplay_streamer
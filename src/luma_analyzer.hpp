@@ -0,0 +1,40 @@
+// src/luma_analyzer.hpp
+#pragma once
+
+#include <airplay_streamer.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct AVFrame;
+
+namespace ender::airplay_streamer {
+    // 每帧的亮度统计：采样行用 SIMD 求和与平方和，行内再隔列取点做直方图；
+    // 每个采样行的（和，平方和）作为签名，与上一帧比较判断画面是否静止。
+    // 只在一个线程上使用
+    class LumaAnalyzer {
+    public:
+        explicit LumaAnalyzer(const Analytics &policy);
+
+        // 帧没有亮度平面时返回 false
+        bool analyze(const AVFrame *frame, FrameAnalytics &out);
+
+    private:
+        struct RowSignature {
+            uint64_t sum;
+            uint64_t sum_squares;
+
+            bool operator==(const RowSignature &other) const = default;
+        };
+
+        int row_step_;
+        int column_step_;
+        int black_level_;
+        float blank_variance_;
+
+        int width_ = 0;
+        int height_ = 0;
+        std::vector<RowSignature> signature_;
+        std::vector<RowSignature> previous_;
+    };
+} // namespace airplay_streamer
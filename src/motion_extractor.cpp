@@ -0,0 +1,65 @@
+// src/motion_extractor.cpp
+
+#include "motion_extractor.hpp"
+
+#include <cmath>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/motion_vector.h>
+}
+
+namespace ender::airplay_streamer {
+    namespace {
+        constexpr int kMacroblockSize = 16;
+    }
+
+    void MotionExtractor::extract(const AVFrame *frame, MotionField &out) {
+        out.columns = (frame->width + kMacroblockSize - 1) / kMacroblockSize;
+        out.rows = (frame->height + kMacroblockSize - 1) / kMacroblockSize;
+        const size_t count = static_cast<size_t>(out.columns) * out.rows;
+        out.blocks.assign(count, MacroblockMotion{});
+        out.moving_blocks = 0;
+        out.mean_magnitude = 0.0f;
+
+        const AVFrameSideData *side = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS);
+        if (!side) return;
+
+        sums_.assign(count * 3, 0);
+        const auto *vectors = reinterpret_cast<const AVMotionVector *>(side->data);
+        const size_t vector_count = side->size / sizeof(AVMotionVector);
+        for (size_t i = 0; i < vector_count; ++i) {
+            const AVMotionVector &mv = vectors[i];
+            // 只看前向参考；镜像流没有 B 帧，后向矢量只在其他来源的流里出现
+            if (mv.source > 0 || mv.motion_scale == 0) continue;
+            const int column = mv.dst_x / kMacroblockSize;
+            const int row = mv.dst_y / kMacroblockSize;
+            if (column < 0 || column >= out.columns || row < 0 || row >= out.rows) continue;
+
+            const int64_t area = static_cast<int64_t>(mv.w) * mv.h;
+            int64_t *sum = &sums_[(static_cast<size_t>(row) * out.columns + column) * 3];
+            sum[0] += static_cast<int64_t>(mv.motion_x) * 4 / mv.motion_scale * area;
+            sum[1] += static_cast<int64_t>(mv.motion_y) * 4 / mv.motion_scale * area;
+            sum[2] += area;
+        }
+
+        double magnitude = 0.0;
+        int inter_blocks = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const int64_t *sum = &sums_[i * 3];
+            if (sum[2] == 0) continue;
+            MacroblockMotion &block = out.blocks[i];
+            block.dx = static_cast<int16_t>(std::llround(static_cast<double>(sum[0]) / static_cast<double>(sum[2])));
+            block.dy = static_cast<int16_t>(std::llround(static_cast<double>(sum[1]) / static_cast<double>(sum[2])));
+            block.inter = true;
+            ++inter_blocks;
+            if (block.dx != 0 || block.dy != 0) {
+                ++out.moving_blocks;
+                magnitude += std::hypot(block.dx, block.dy) / 4.0;
+            }
+        }
+        if (inter_blocks > 0) {
+            out.mean_magnitude = static_cast<float>(magnitude / inter_blocks);
+        }
+    }
+} // namespace airplay_streamer
@@ -0,0 +1,23 @@
+// src/motion_extractor.hpp
+#pragma once
+
+#include <frame_extras.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct AVFrame;
+
+namespace ender::airplay_streamer {
+    // 把帧上 AV_FRAME_DATA_MOTION_VECTORS 的逐分区运动矢量汇总成每宏块一个。
+    // 只在一个线程上使用
+    class MotionExtractor {
+    public:
+        // 帧上没有运动矢量（关键帧）时所有宏块都标为帧内编码
+        void extract(const AVFrame *frame, MotionField &out);
+
+    private:
+        // 每个宏块的加权和：x、y（1/4 像素乘面积）和面积
+        std::vector<int64_t> sums_;
+    };
+} // namespace airplay_streamer
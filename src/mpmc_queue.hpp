@@ -0,0 +1,94 @@
+// src/mpmc_queue.hpp
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace ender::airplay_streamer {
+    // 有界多生产者/多消费者无锁队列（Vyukov）。
+    // 下标 pos 落在槽位 pos % capacity 的第 pos / capacity 轮，槽位序号为 2 * 轮次时可写、
+    // 2 * 轮次 + 1 时可读，读完后设为下一轮的 2 * (轮次 + 1)；生产者和消费者各自用 CAS 抢下标。
+    // 序号按轮次而不是按下标递增，capacity 为 1 时“可读”和“下一轮可写”也不会是同一个值
+    template<typename T>
+    class MpmcQueue {
+    public:
+        explicit MpmcQueue(const size_t capacity)
+            : capacity_(capacity ? capacity : 1), slots_(std::make_unique<Slot[]>(capacity_)) {
+            for (size_t i = 0; i < capacity_; ++i) {
+                slots_[i].sequence.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        MpmcQueue(const MpmcQueue &) = delete;
+
+        MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+        // 队列已满时返回 false，value 保持不变
+        bool tryPush(T &value) {
+            size_t pos = tail_.load(std::memory_order_relaxed);
+            while (true) {
+                Slot &slot = slots_[pos % capacity_];
+                const size_t turn = 2 * (pos / capacity_);
+                const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<ptrdiff_t>(sequence - turn);
+                if (diff == 0) {
+                    if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        slot.value = std::move(value);
+                        slot.sequence.store(turn + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = tail_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // 队列为空时返回 false
+        bool tryPop(T &out) {
+            size_t pos = head_.load(std::memory_order_relaxed);
+            while (true) {
+                Slot &slot = slots_[pos % capacity_];
+                const size_t turn = 2 * (pos / capacity_);
+                const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<ptrdiff_t>(sequence - (turn + 1));
+                if (diff == 0) {
+                    if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        out = std::move(slot.value);
+                        slot.sequence.store(turn + 2, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = head_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // 任意线程调用，结果只是近似值
+        size_t size() const {
+            const size_t head = head_.load(std::memory_order_acquire);
+            const size_t tail = tail_.load(std::memory_order_acquire);
+            return tail > head ? tail - head : 0;
+        }
+
+        size_t capacity() const { return capacity_; }
+
+    private:
+        static constexpr size_t kCacheLine = 64;
+
+        struct alignas(kCacheLine) Slot {
+            std::atomic<size_t> sequence{0};
+            T value{};
+        };
+
+        const size_t capacity_;
+        std::unique_ptr<Slot[]> slots_;
+
+        alignas(kCacheLine) std::atomic<size_t> head_{0};
+        alignas(kCacheLine) std::atomic<size_t> tail_{0};
+    };
+} // namespace airplay_streamer
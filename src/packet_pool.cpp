@@ -0,0 +1,37 @@
+// src/packet_pool.cpp
+
+#include "packet_pool.hpp"
+
+#include <cstring>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/buffer.h>
+}
+
+namespace ender::airplay_streamer {
+    PacketPool::~PacketPool() {
+        // 解码器手里还没释放的缓冲归还时才真正释放
+        av_buffer_pool_uninit(&pool_);
+    }
+
+    AVBufferRef *PacketPool::acquire(const size_t size) {
+        const size_t needed = size + AV_INPUT_BUFFER_PADDING_SIZE;
+        if (!pool_ || needed > block_size_) {
+            size_t block_size = kMinBlockSize;
+            while (block_size < needed) block_size <<= 1;
+
+            av_buffer_pool_uninit(&pool_);
+            pool_ = av_buffer_pool_init(block_size, av_buffer_alloc);
+            block_size_ = pool_ ? block_size : 0;
+            if (!pool_) return nullptr;
+        }
+
+        AVBufferRef *buffer = av_buffer_pool_get(pool_);
+        if (buffer) {
+            // 填充区清零，解码器可能越界读到这里
+            memset(buffer->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+        }
+        return buffer;
+    }
+} // namespace airplay_streamer
@@ -0,0 +1,34 @@
+// src/packet_pool.hpp
+#pragma once
+
+#include <cstddef>
+
+struct AVBufferPool;
+struct AVBufferRef;
+
+namespace ender::airplay_streamer {
+    // 压缩帧缓冲池：mirror 线程把解密后的数据直接写进这里取出的缓冲，
+    // 缓冲以 AVBufferRef 的形式一路交给 libavcodec，解码器释放后自动回到池中。
+    // 每块缓冲末尾都带 AV_INPUT_BUFFER_PADDING_SIZE 字节的填充。
+    // 只在 mirror 线程上调用 acquire，不加锁
+    class PacketPool {
+    public:
+        PacketPool() = default;
+
+        ~PacketPool();
+
+        PacketPool(const PacketPool &) = delete;
+
+        PacketPool &operator=(const PacketPool &) = delete;
+
+        // 取出一块至少能容纳 size 字节数据加填充的缓冲，填充区已清零；
+        // 遇到更大的帧时按 2 的幂扩大池的块大小
+        AVBufferRef *acquire(size_t size);
+
+    private:
+        static constexpr size_t kMinBlockSize = 256 * 1024;
+
+        AVBufferPool *pool_ = nullptr;
+        size_t block_size_ = 0;
+    };
+} // namespace airplay_streamer
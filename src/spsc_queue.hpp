@@ -0,0 +1,67 @@
+// src/spsc_queue.hpp
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace ender::airplay_streamer {
+    // 有界单生产者/单消费者无锁队列。
+    // 生产者只写 tail_，消费者只写 head_，各自缓存对方的下标以减少跨核读取
+    template<typename T>
+    class SpscQueue {
+    public:
+        explicit SpscQueue(const size_t capacity) : capacity_(capacity ? capacity : 1), slots_(capacity_) {
+        }
+
+        SpscQueue(const SpscQueue &) = delete;
+
+        SpscQueue &operator=(const SpscQueue &) = delete;
+
+        // 生产者线程调用；队列已满时返回 false，value 保持不变
+        bool tryPush(T &value) {
+            const size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_cache_ >= capacity_) {
+                head_cache_ = head_.load(std::memory_order_acquire);
+                if (tail - head_cache_ >= capacity_) return false;
+            }
+            slots_[tail % capacity_] = std::move(value);
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // 消费者线程调用；队列为空时返回 false
+        bool tryPop(T &out) {
+            const size_t head = head_.load(std::memory_order_relaxed);
+            if (head == tail_cache_) {
+                tail_cache_ = tail_.load(std::memory_order_acquire);
+                if (head == tail_cache_) return false;
+            }
+            out = std::move(slots_[head % capacity_]);
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // 任意线程调用，结果只是近似值
+        size_t size() const {
+            const size_t head = head_.load(std::memory_order_acquire);
+            const size_t tail = tail_.load(std::memory_order_acquire);
+            return tail > head ? tail - head : 0;
+        }
+
+        size_t capacity() const { return capacity_; }
+
+    private:
+        static constexpr size_t kCacheLine = 64;
+
+        const size_t capacity_;
+        std::vector<T> slots_;
+
+        alignas(kCacheLine) std::atomic<size_t> head_{0};
+        size_t tail_cache_ = 0;
+
+        alignas(kCacheLine) std::atomic<size_t> tail_{0};
+        size_t head_cache_ = 0;
+    };
+} // namespace airplay_streamer
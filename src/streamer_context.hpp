@@ -0,0 +1,40 @@
+// src/streamer_context.hpp
+#pragma once
+
+#include <airplay_streamer.hpp>
+#include "decoder_pool.hpp"
+#include "decoder_settings.hpp"
+#include "frame_fanout.hpp"
+
+#include <atomic>
+
+namespace ender::airplay_streamer {
+    // 所有会话共享的状态，生命周期和 StreamerCore 相同
+    struct StreamerContext {
+        StreamerContext(const Config &config, const SinkHooks hooks) : config(config), hooks(hooks) {
+        }
+
+        const Config &config;
+
+        // on_video_data / on_audio_data / log_callback 的编译期接收者
+        const SinkHooks hooks;
+
+        // 已经打开解码器的会话数，自动线程数按它分配 CPU
+        std::atomic<int> decoding_sessions{0};
+
+        // 最近一次打开解码器时的编码分辨率，mirror SETUP 和会话结束时预热按它选设置
+        std::atomic<int> last_width{1920};
+        std::atomic<int> last_height{1080};
+
+        // 按当前正在解码的会话数选择解码器设置；counted 表示调用方已经计入 decoding_sessions。
+        // 打开解码器和预热都走这里，算出的设置才能在池里精确匹配
+        DecoderSettings decoderSettingsFor(const int width, const int height, const bool counted) const {
+            const int sessions = decoding_sessions.load(std::memory_order_relaxed) + (counted ? 0 : 1);
+            return chooseDecoderSettings(config, width, height, sessions);
+        }
+
+        DecoderPool decoder_pool;
+
+        FrameFanout fanout;
+    };
+} // namespace airplay_streamer
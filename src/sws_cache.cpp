@@ -0,0 +1,139 @@
+// src/sws_cache.cpp
+
+#include "sws_cache.hpp"
+#include "frame_pool.hpp"
+#include "yuv_convert.hpp"
+
+#include <algorithm>
+
+extern "C" {
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+#include <libswscale/swscale.h>
+}
+
+namespace ender::airplay_streamer {
+    namespace {
+        constexpr int kAlign = 64;
+    }
+
+    struct SwsCache::Entry {
+        Key key;
+        AVBufferPool *pool = nullptr;
+        int buffer_size = 0;
+
+        std::mutex mutex;
+        std::vector<SwsContext *> idle; // 空闲的转换器，用时取出、用完放回
+
+        ~Entry() {
+            av_buffer_pool_uninit(&pool);
+            for (SwsContext *ctx: idle) {
+                sws_freeContext(ctx);
+            }
+        }
+
+        SwsContext *acquire() {
+            {
+                std::lock_guard lock(mutex);
+                if (!idle.empty()) {
+                    SwsContext *ctx = idle.back();
+                    idle.pop_back();
+                    return ctx;
+                }
+            }
+            const auto src_format = static_cast<AVPixelFormat>(key.src_format);
+            const auto dst_format = static_cast<AVPixelFormat>(key.dst_format);
+            SwsContext *ctx = sws_getContext(key.width, key.height, src_format, key.width, key.height, dst_format,
+                                             SWS_BILINEAR, nullptr, nullptr, nullptr);
+            if (ctx) {
+                // 与快速路径用同一套矩阵和范围
+                const int cs = key.colorspace == AVCOL_SPC_BT709 ? SWS_CS_ITU709 : SWS_CS_ITU601;
+                sws_setColorspaceDetails(ctx, sws_getCoefficients(cs), key.color_range == AVCOL_RANGE_JPEG,
+                                         sws_getCoefficients(SWS_CS_DEFAULT), 1, 0, 1 << 16, 1 << 16);
+            }
+            return ctx;
+        }
+
+        void release(SwsContext *ctx) {
+            std::lock_guard lock(mutex);
+            idle.push_back(ctx);
+        }
+    };
+
+    SwsCache &SwsCache::instance() {
+        static SwsCache cache;
+        return cache;
+    }
+
+    std::shared_ptr<SwsCache::Entry> SwsCache::entry(const Key &key) {
+        std::lock_guard lock(mutex_);
+        const auto it = std::find_if(entries_.begin(), entries_.end(),
+                                     [&key](const std::shared_ptr<Entry> &e) { return e->key == key; });
+        if (it != entries_.end()) {
+            std::rotate(it, it + 1, entries_.end());
+            return entries_.back();
+        }
+
+        const int size = paddedImageSize(key.dst_format, key.width, key.height, kAlign);
+        if (size <= kFramePadding) return nullptr;
+
+        auto created = std::make_shared<Entry>();
+        created->key = key;
+        created->buffer_size = size;
+        created->pool = av_buffer_pool_init(created->buffer_size, av_buffer_alloc);
+        if (!created->pool) return nullptr;
+
+        if (entries_.size() >= kMaxEntries) {
+            // 正在用的 Entry 由调用方的 shared_ptr 保活
+            entries_.erase(entries_.begin());
+        }
+        entries_.push_back(created);
+        return created;
+    }
+
+    std::shared_ptr<AVFrame> SwsCache::convert(const AVFrame *src, const AVPixelFormat dst_format) {
+        if (!src || src->width <= 0 || src->height <= 0) return nullptr;
+
+        Key key;
+        key.width = src->width;
+        key.height = src->height;
+        key.src_format = src->format;
+        key.dst_format = dst_format;
+        key.colorspace = yuv::isBt709(src) ? AVCOL_SPC_BT709 : AVCOL_SPC_BT470BG;
+        key.color_range = yuv::isFullRange(src) ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+        const std::shared_ptr<Entry> cached = entry(key);
+        if (!cached) return nullptr;
+
+        AVFrame *raw = av_frame_alloc();
+        if (!raw) return nullptr;
+        std::shared_ptr<AVFrame> dst(raw, [](AVFrame *frame) { av_frame_free(&frame); });
+
+        dst->buf[0] = av_buffer_pool_get(cached->pool);
+        if (!dst->buf[0]) return nullptr;
+        dst->format = dst_format;
+        dst->width = src->width;
+        dst->height = src->height;
+        av_image_fill_arrays(dst->data, dst->linesize, dst->buf[0]->data, dst_format, dst->width, dst->height,
+                             kAlign);
+        av_frame_copy_props(dst.get(), src);
+
+        const bool i420 = src->format == AV_PIX_FMT_YUV420P || src->format == AV_PIX_FMT_YUVJ420P;
+        if (i420 && dst_format == AV_PIX_FMT_BGRA) {
+            yuv::i420ToBgra(src->data, src->linesize, dst->data[0], dst->linesize[0], src->width, src->height,
+                            yuv::coefficients(yuv::isBt709(src), yuv::isFullRange(src)));
+            return dst;
+        }
+        if (i420 && dst_format == AV_PIX_FMT_NV12) {
+            yuv::i420ToNv12(src->data, src->linesize, dst->data[0], dst->linesize[0], dst->data[1],
+                            dst->linesize[1], src->width, src->height);
+            return dst;
+        }
+
+        SwsContext *ctx = cached->acquire();
+        if (!ctx) return nullptr;
+        const int rows = sws_scale(ctx, src->data, src->linesize, 0, src->height, dst->data, dst->linesize);
+        cached->release(ctx);
+        return rows > 0 ? dst : nullptr;
+    }
+} // namespace airplay_streamer
@@ -0,0 +1,56 @@
+// src/sws_cache.hpp
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+#include <libavutil/pixfmt.h>
+}
+
+struct AVBufferPool;
+struct AVFrame;
+struct SwsContext;
+
+namespace ender::airplay_streamer {
+    // 进程内共享的像素格式转换器：
+    //  - 每个（尺寸，源格式，目标格式）组合缓存一个 SwsContext，同一组合并发转换时才会多建
+    //  - 输出缓冲来自同一组合的 AVBufferPool，稳态下不再逐帧申请大块内存
+    //  - yuv420p -> BGRA / NV12 不经过 swscale，走 SIMD 快速路径
+    class SwsCache {
+    public:
+        static SwsCache &instance();
+
+        SwsCache(const SwsCache &) = delete;
+
+        SwsCache &operator=(const SwsCache &) = delete;
+
+        // 转换 src，结果带着 src 的时间戳等属性；失败返回 nullptr
+        std::shared_ptr<AVFrame> convert(const AVFrame *src, AVPixelFormat dst_format);
+
+    private:
+        struct Key {
+            int width = 0;
+            int height = 0;
+            int src_format = -1;
+            int dst_format = -1;
+            int colorspace = 0;
+            int color_range = 0;
+
+            bool operator==(const Key &other) const = default;
+        };
+
+        struct Entry;
+
+        // 超过这么多组合时淘汰最久没用的
+        static constexpr size_t kMaxEntries = 8;
+
+        SwsCache() = default;
+
+        std::shared_ptr<Entry> entry(const Key &key);
+
+        std::mutex mutex_;
+        std::vector<std::shared_ptr<Entry>> entries_; // 按最近使用排序，末尾最新
+    };
+} // namespace airplay_streamer
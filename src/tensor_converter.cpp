@@ -0,0 +1,407 @@
+// src/tensor_converter.cpp
+
+#include "tensor_converter.hpp"
+#include "sws_cache.hpp"
+#include "yuv_convert.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AIRPLAY_TENSOR_SSE2 1
+#endif
+
+extern "C" {
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+}
+
+namespace ender::airplay_streamer {
+    namespace {
+        // 双线性采样一行，权重均为 Q8
+        void sampleRow(const uint8_t *r0, const uint8_t *r1, const int wy, const std::vector<TensorConverter::Tap> &taps,
+                       uint8_t *dst) {
+            const int wy0 = 256 - wy;
+            for (size_t i = 0; i < taps.size(); ++i) {
+                const auto &[x0, x1, wx] = taps[i];
+                const int wx0 = 256 - wx;
+                const int top = r0[x0] * wx0 + r0[x1] * wx;
+                const int bottom = r1[x0] * wx0 + r1[x1] * wx;
+                dst[i] = static_cast<uint8_t>((top * wy0 + bottom * wy + 32768) >> 16);
+            }
+        }
+
+        // 一行 8 位像素归一化成 float：value * scale + bias
+        void normalizeRow(const uint8_t *src, float *dst, const int width, const float scale, const float bias) {
+            int x = 0;
+#ifdef AIRPLAY_TENSOR_SSE2
+            const __m128i zero = _mm_setzero_si128();
+            const __m128 s = _mm_set1_ps(scale);
+            const __m128 b = _mm_set1_ps(bias);
+            for (; x + 16 <= width; x += 16) {
+                const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+                const __m128i lo = _mm_unpacklo_epi8(p, zero);
+                const __m128i hi = _mm_unpackhi_epi8(p, zero);
+                const __m128i q[4] = {
+                    _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+                    _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)
+                };
+                for (int i = 0; i < 4; ++i) {
+                    _mm_storeu_ps(dst + x + 4 * i, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(q[i]), s), b));
+                }
+            }
+#endif
+            for (; x < width; ++x) {
+                dst[x] = static_cast<float>(src[x]) * scale + bias;
+            }
+        }
+
+        // 目标坐标 i 映射到源图（像素中心对齐），返回截断后的采样位置
+        float sourceCoord(const int i, const int src_size, const int dst_size) {
+            const float s = (static_cast<float>(i) + 0.5f) * static_cast<float>(src_size) /
+                            static_cast<float>(dst_size) - 0.5f;
+            return std::clamp(s, 0.0f, static_cast<float>(src_size - 1));
+        }
+
+        TensorConverter::Tap makeTap(const float s, const int size) {
+            const int x0 = std::min(static_cast<int>(s), size - 1);
+            const int x1 = std::min(x0 + 1, size - 1);
+            const int weight = static_cast<int>(std::lround((s - static_cast<float>(x0)) * 256.0f));
+            return {x0, x1, std::clamp(weight, 0, 256)};
+        }
+    }
+
+    // Tensor 外壳和 shared_ptr 控制块的缓存，做法同 FramePool：最后一个引用释放时回到这里。
+    // 控制块里的分配器副本持有池的引用，会话结束后消费者还拿着的张量也能正常归还
+    class TensorShellPool : public std::enable_shared_from_this<TensorShellPool> {
+    public:
+        ~TensorShellPool() {
+            for (Shell *shell: shells_) {
+                delete shell;
+            }
+            for (void *block: blocks_) {
+                ::operator delete(block);
+            }
+        }
+
+        // 接管 buffer 的引用（调用方提供的缓冲时为空），张量释放时一起归还
+        std::shared_ptr<const Tensor> make(const Tensor &fields, AVBufferRef *buffer) {
+            Shell *shell = acquireShell();
+            shell->tensor = fields;
+            shell->buffer = buffer;
+            return {&shell->tensor, Recycler{this}, Allocator<Tensor>(shared_from_this())};
+        }
+
+    private:
+        // tensor 必须是第一个成员，Recycler 按 Tensor 指针找回整个外壳
+        struct Shell {
+            Tensor tensor;
+            AVBufferRef *buffer = nullptr;
+        };
+
+        struct Recycler {
+            TensorShellPool *pool;
+
+            void operator()(const Tensor *tensor) const {
+                pool->recycleShell(reinterpret_cast<Shell *>(const_cast<Tensor *>(tensor)));
+            }
+        };
+
+        template<typename T>
+        class Allocator {
+        public:
+            using value_type = T;
+
+            explicit Allocator(std::shared_ptr<TensorShellPool> pool) : pool_(std::move(pool)) {
+            }
+
+            template<typename U>
+            Allocator(const Allocator<U> &other) : pool_(other.pool_) {
+            }
+
+            T *allocate(const size_t n) {
+                return static_cast<T *>(pool_->allocateBlock(n * sizeof(T)));
+            }
+
+            void deallocate(T *p, const size_t n) {
+                pool_->deallocateBlock(p, n * sizeof(T));
+            }
+
+            template<typename U>
+            bool operator==(const Allocator<U> &other) const { return pool_ == other.pool_; }
+
+        private:
+            template<typename U>
+            friend class Allocator;
+
+            std::shared_ptr<TensorShellPool> pool_;
+        };
+
+        Shell *acquireShell() {
+            {
+                std::lock_guard lock(mutex_);
+                if (!shells_.empty()) {
+                    Shell *shell = shells_.back();
+                    shells_.pop_back();
+                    return shell;
+                }
+            }
+            return new Shell;
+        }
+
+        void recycleShell(Shell *shell) {
+            // 内部池的缓冲在这里归还给 AVBufferPool
+            av_buffer_unref(&shell->buffer);
+            {
+                std::lock_guard lock(mutex_);
+                if (shells_.size() < kMaxCached) {
+                    shells_.push_back(shell);
+                    return;
+                }
+            }
+            delete shell;
+        }
+
+        void *allocateBlock(const size_t size) {
+            if (size <= kBlockSize) {
+                {
+                    std::lock_guard lock(mutex_);
+                    if (!blocks_.empty()) {
+                        void *block = blocks_.back();
+                        blocks_.pop_back();
+                        return block;
+                    }
+                }
+                return ::operator new(kBlockSize);
+            }
+            return ::operator new(size);
+        }
+
+        void deallocateBlock(void *block, const size_t size) {
+            if (size <= kBlockSize) {
+                std::lock_guard lock(mutex_);
+                if (blocks_.size() < kMaxCached) {
+                    blocks_.push_back(block);
+                    return;
+                }
+            }
+            ::operator delete(block);
+        }
+
+        // shared_ptr 控制块的固定大小，超过的走普通 new
+        static constexpr size_t kBlockSize = 128;
+        // 消费者同时持有的张量一般只有几个
+        static constexpr size_t kMaxCached = 16;
+
+        std::mutex mutex_;
+        std::vector<Shell *> shells_;
+        std::vector<void *> blocks_;
+    };
+
+    TensorConverter::TensorConverter(const TensorSpec &spec) : spec_(spec),
+                                                               shells_(std::make_shared<TensorShellPool>()) {
+        element_size_ = spec_.type == TensorType::Float32 ? sizeof(float) : sizeof(uint8_t);
+        bytes_ = static_cast<size_t>(spec_.width) * spec_.height * 3 * element_size_;
+        // av_malloc 的对齐（至少 16 字节，启用 AVX 的构建为 32/64）
+        pool_ = av_buffer_pool_init(bytes_, av_buffer_alloc);
+
+        for (int c = 0; c < 3; ++c) {
+            const float std_dev = spec_.std[c] != 0.0f ? spec_.std[c] : 1.0f;
+            if (spec_.type == TensorType::Float32) {
+                scale_[c] = 1.0f / (255.0f * std_dev);
+                bias_[c] = -spec_.mean[c] / std_dev;
+            } else {
+                scale_[c] = 1.0f;
+                bias_[c] = 0.0f;
+            }
+            pad_[c] = static_cast<float>(spec_.pad_value) * scale_[c] + bias_[c];
+        }
+    }
+
+    TensorConverter::~TensorConverter() {
+        // 还被消费者持有的缓冲归还时才真正释放
+        av_buffer_pool_uninit(&pool_);
+    }
+
+    void TensorConverter::prepare(const int src_width, const int src_height) {
+        src_width_ = src_width;
+        src_height_ = src_height;
+
+        if (spec_.letterbox) {
+            const double scale = std::min(static_cast<double>(spec_.width) / src_width,
+                                          static_cast<double>(spec_.height) / src_height);
+            content_width_ = std::clamp(static_cast<int>(std::lround(src_width * scale)), 1, spec_.width);
+            content_height_ = std::clamp(static_cast<int>(std::lround(src_height * scale)), 1, spec_.height);
+        } else {
+            content_width_ = spec_.width;
+            content_height_ = spec_.height;
+        }
+        pad_left_ = (spec_.width - content_width_) / 2;
+        pad_top_ = (spec_.height - content_height_) / 2;
+
+        // 色度按 H.264 默认的左对齐位置采样：水平方向色度坐标 = 亮度坐标 / 2
+        const int chroma_width = (src_width + 1) >> 1;
+        luma_taps_.resize(content_width_);
+        chroma_taps_.resize(content_width_);
+        for (int x = 0; x < content_width_; ++x) {
+            const float sx = sourceCoord(x, src_width, content_width_);
+            luma_taps_[x] = makeTap(sx, src_width);
+            chroma_taps_[x] = makeTap(std::min(sx * 0.5f, static_cast<float>(chroma_width - 1)), chroma_width);
+        }
+
+        rows_.resize(static_cast<size_t>(content_width_) * 6);
+    }
+
+    void TensorConverter::fillPadding(uint8_t *dst, const int x, const int y, const int count) const {
+        if (count <= 0) return;
+        const size_t plane = static_cast<size_t>(spec_.width) * spec_.height;
+        const size_t begin = static_cast<size_t>(y) * spec_.width + x;
+
+        if (spec_.type == TensorType::Uint8) {
+            if (spec_.layout == TensorLayout::Nchw) {
+                for (int c = 0; c < 3; ++c) {
+                    memset(dst + c * plane + begin, spec_.pad_value, count);
+                }
+            } else {
+                memset(dst + begin * 3, spec_.pad_value, static_cast<size_t>(count) * 3);
+            }
+            return;
+        }
+
+        auto *out = reinterpret_cast<float *>(dst);
+        if (spec_.layout == TensorLayout::Nchw) {
+            for (int c = 0; c < 3; ++c) {
+                std::fill_n(out + c * plane + begin, count, pad_[c]);
+            }
+        } else {
+            float *p = out + begin * 3;
+            for (int i = 0; i < count; ++i, p += 3) {
+                p[0] = pad_[0];
+                p[1] = pad_[1];
+                p[2] = pad_[2];
+            }
+        }
+    }
+
+    void TensorConverter::storeRow(uint8_t *dst, const int row) const {
+        const size_t width = content_width_;
+        const uint8_t *r = rows_.data() + 3 * width;
+        const uint8_t *g = r + width;
+        const uint8_t *b = g + width;
+        const uint8_t *channels[3] = {spec_.bgr ? b : r, g, spec_.bgr ? r : b};
+
+        const size_t plane = static_cast<size_t>(spec_.width) * spec_.height;
+        const size_t begin = static_cast<size_t>(pad_top_ + row) * spec_.width + pad_left_;
+
+        if (spec_.layout == TensorLayout::Nchw) {
+            for (int c = 0; c < 3; ++c) {
+                if (spec_.type == TensorType::Float32) {
+                    normalizeRow(channels[c], reinterpret_cast<float *>(dst) + c * plane + begin,
+                                 content_width_, scale_[c], bias_[c]);
+                } else {
+                    memcpy(dst + c * plane + begin, channels[c], width);
+                }
+            }
+            return;
+        }
+
+        if (spec_.type == TensorType::Float32) {
+            float *p = reinterpret_cast<float *>(dst) + begin * 3;
+            for (size_t x = 0; x < width; ++x, p += 3) {
+                p[0] = static_cast<float>(channels[0][x]) * scale_[0] + bias_[0];
+                p[1] = static_cast<float>(channels[1][x]) * scale_[1] + bias_[1];
+                p[2] = static_cast<float>(channels[2][x]) * scale_[2] + bias_[2];
+            }
+        } else {
+            uint8_t *p = dst + begin * 3;
+            for (size_t x = 0; x < width; ++x, p += 3) {
+                p[0] = channels[0][x];
+                p[1] = channels[1][x];
+                p[2] = channels[2][x];
+            }
+        }
+    }
+
+    std::shared_ptr<const Tensor> TensorConverter::convert(const AVFrame *frame, const int64_t pts,
+                                                           const uint64_t session_id,
+                                                           const TensorAllocator &allocator) {
+        if (!pool_ || !frame || frame->width <= 0 || frame->height <= 0) return nullptr;
+
+        // 解码器输出基本都是 yuv420p，其他格式先经 SwsCache 转一次
+        std::shared_ptr<AVFrame> converted;
+        const AVFrame *src = frame;
+        if (frame->format != AV_PIX_FMT_YUV420P && frame->format != AV_PIX_FMT_YUVJ420P) {
+            converted = SwsCache::instance().convert(frame, AV_PIX_FMT_YUV420P);
+            if (!converted) return nullptr;
+            src = converted.get();
+        }
+
+        if (src->width != src_width_ || src->height != src_height_) {
+            prepare(src->width, src->height);
+        }
+
+        void *data = allocator ? allocator(bytes_, pts) : nullptr;
+        AVBufferRef *buffer = nullptr;
+        if (!data) {
+            buffer = av_buffer_pool_get(pool_);
+            if (!buffer) return nullptr;
+            data = buffer->data;
+        }
+        auto *dst = static_cast<uint8_t *>(data);
+
+        // 填充区每帧都写：调用方提供的缓冲内容未知
+        const int bottom = pad_top_ + content_height_;
+        fillPadding(dst, 0, 0, pad_top_ * spec_.width);
+        fillPadding(dst, 0, bottom, (spec_.height - bottom) * spec_.width);
+
+        const yuv::Coefficients &k = yuv::coefficients(yuv::isBt709(src), yuv::isFullRange(src));
+        const int chroma_height = (src_height_ + 1) >> 1;
+        const size_t width = content_width_;
+        uint8_t *y_row = rows_.data();
+        uint8_t *u_row = y_row + width;
+        uint8_t *v_row = u_row + width;
+        uint8_t *r_row = v_row + width;
+
+        for (int row = 0; row < content_height_; ++row) {
+            const float sy = sourceCoord(row, src_height_, content_height_);
+            const Tap ty = makeTap(sy, src_height_);
+            // 垂直方向色度位于两行亮度中间
+            const float csy = std::clamp((sy + 0.5f) * 0.5f - 0.5f, 0.0f, static_cast<float>(chroma_height - 1));
+            const Tap tc = makeTap(csy, chroma_height);
+
+            sampleRow(src->data[0] + static_cast<ptrdiff_t>(ty.x0) * src->linesize[0],
+                      src->data[0] + static_cast<ptrdiff_t>(ty.x1) * src->linesize[0], ty.weight, luma_taps_, y_row);
+            sampleRow(src->data[1] + static_cast<ptrdiff_t>(tc.x0) * src->linesize[1],
+                      src->data[1] + static_cast<ptrdiff_t>(tc.x1) * src->linesize[1], tc.weight, chroma_taps_, u_row);
+            sampleRow(src->data[2] + static_cast<ptrdiff_t>(tc.x0) * src->linesize[2],
+                      src->data[2] + static_cast<ptrdiff_t>(tc.x1) * src->linesize[2], tc.weight, chroma_taps_, v_row);
+
+            yuv::yuvToPlanarRgb(y_row, u_row, v_row, r_row, r_row + width, r_row + 2 * width, content_width_, k);
+
+            fillPadding(dst, 0, pad_top_ + row, pad_left_);
+            storeRow(dst, row);
+            fillPadding(dst, pad_left_ + content_width_, pad_top_ + row, spec_.width - pad_left_ - content_width_);
+        }
+
+        Tensor tensor;
+        tensor.session_id = session_id;
+        tensor.pts = pts;
+        tensor.data = data;
+        tensor.size = bytes_;
+        tensor.width = spec_.width;
+        tensor.height = spec_.height;
+        tensor.layout = spec_.layout;
+        tensor.type = spec_.type;
+        tensor.pad_left = pad_left_;
+        tensor.pad_top = pad_top_;
+        tensor.content_width = content_width_;
+        tensor.content_height = content_height_;
+        tensor.scale_x = static_cast<float>(content_width_) / static_cast<float>(src_width_);
+        tensor.scale_y = static_cast<float>(content_height_) / static_cast<float>(src_height_);
+        return shells_->make(tensor, buffer);
+    }
+} // namespace airplay_streamer
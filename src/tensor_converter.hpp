@@ -0,0 +1,73 @@
+// src/tensor_converter.hpp
+#pragma once
+
+#include <tensor.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct AVBufferPool;
+struct AVFrame;
+
+namespace ender::airplay_streamer {
+    class TensorShellPool;
+
+    // 解码帧 -> 模型输入张量：缩放（双线性，可选 letterbox）、YUV -> RGB 和 mean/std 归一化
+    // 在同一趟逐行处理里完成，每行的中间结果只在几个行缓冲里，不产生整帧的中间图像。
+    // 只在一个线程上使用
+    class TensorConverter {
+    public:
+        explicit TensorConverter(const TensorSpec &spec);
+
+        ~TensorConverter();
+
+        TensorConverter(const TensorConverter &) = delete;
+
+        TensorConverter &operator=(const TensorConverter &) = delete;
+
+        // allocator 为空或返回 nullptr 时输出到内部池的缓冲；失败返回 nullptr
+        std::shared_ptr<const Tensor> convert(const AVFrame *frame, int64_t pts, uint64_t session_id,
+                                              const TensorAllocator &allocator);
+
+        size_t bytes() const { return bytes_; }
+
+        // 目标坐标在源图上的两个采样点和后一个的权重（Q8）
+        struct Tap {
+            int x0;
+            int x1;
+            int weight;
+        };
+
+    private:
+        void prepare(int src_width, int src_height);
+
+        void fillPadding(uint8_t *dst, int x, int y, int count) const;
+
+        void storeRow(uint8_t *dst, int row) const;
+
+        TensorSpec spec_;
+        size_t bytes_ = 0;
+        size_t element_size_ = 0;
+        AVBufferPool *pool_ = nullptr;
+        std::shared_ptr<TensorShellPool> shells_; // Tensor 外壳和 shared_ptr 控制块
+
+        // 归一化：value * scale_[c] + bias_[c]，pad_[c] 为填充值归一化后的结果
+        float scale_[3] = {};
+        float bias_[3] = {};
+        float pad_[3] = {};
+
+        // 按源尺寸准备的几何参数
+        int src_width_ = 0;
+        int src_height_ = 0;
+        int content_width_ = 0;
+        int content_height_ = 0;
+        int pad_left_ = 0;
+        int pad_top_ = 0;
+        std::vector<Tap> luma_taps_;
+        std::vector<Tap> chroma_taps_;
+
+        // 行缓冲：采样后的 Y/U/V 和转换后的 R/G/B
+        std::vector<uint8_t> rows_;
+    };
+} // namespace airplay_streamer
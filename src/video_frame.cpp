@@ -0,0 +1,72 @@
+// src/video_frame.cpp
+
+#include <video_frame.hpp>
+#include "sws_cache.hpp"
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace ender::airplay_streamer {
+    namespace {
+        AVPixelFormat toAvFormat(const PixelFormat format) {
+            switch (format) {
+                case PixelFormat::Yuv420p: return AV_PIX_FMT_YUV420P;
+                case PixelFormat::Nv12: return AV_PIX_FMT_NV12;
+                case PixelFormat::Bgra: return AV_PIX_FMT_BGRA;
+                case PixelFormat::Rgba: return AV_PIX_FMT_RGBA;
+                case PixelFormat::Rgb24: return AV_PIX_FMT_RGB24;
+                case PixelFormat::Bgr24: return AV_PIX_FMT_BGR24;
+                case PixelFormat::Gray8: return AV_PIX_FMT_GRAY8;
+                default: return AV_PIX_FMT_NONE;
+            }
+        }
+
+        bool sameFormat(const AVFrame *frame, const AVPixelFormat format) {
+            // YUVJ420P 和 YUV420P 内存布局一样，只是范围标记不同
+            return frame->format == format ||
+                   (format == AV_PIX_FMT_YUV420P && frame->format == AV_PIX_FMT_YUVJ420P);
+        }
+    }
+
+    std::shared_ptr<VideoFrame> VideoFrame::create(std::shared_ptr<AVFrame> frame, const int64_t pts) {
+        if (!frame) return nullptr;
+        return std::make_shared<VideoFrame>(std::move(frame), pts);
+    }
+
+    VideoFrame::VideoFrame(std::shared_ptr<AVFrame> frame, const int64_t pts) : frame_(std::move(frame)), pts_(pts) {
+    }
+
+    VideoFrame::~VideoFrame() = default;
+
+    int VideoFrame::width() const {
+        return frame_ ? frame_->width : 0;
+    }
+
+    int VideoFrame::height() const {
+        return frame_ ? frame_->height : 0;
+    }
+
+    std::shared_ptr<AVFrame> VideoFrame::as(const PixelFormat format) {
+        const AVPixelFormat av_format = toAvFormat(format);
+        if (!frame_ || av_format == AV_PIX_FMT_NONE) return nullptr;
+        if (sameFormat(frame_.get(), av_format)) return frame_;
+
+        // 同时请求同一格式的其他线程等着拿同一份结果；请求其他格式的线程不受影响
+        auto &slot = converted_[static_cast<size_t>(format)];
+        std::call_once(slot.once, [this, &slot, av_format] {
+            slot.frame = SwsCache::instance().convert(frame_.get(), av_format);
+            slot.done.store(true, std::memory_order_release);
+        });
+        return slot.frame;
+    }
+
+    bool VideoFrame::has(const PixelFormat format) const {
+        const AVPixelFormat av_format = toAvFormat(format);
+        if (!frame_ || av_format == AV_PIX_FMT_NONE) return false;
+        if (sameFormat(frame_.get(), av_format)) return true;
+
+        const auto &slot = converted_[static_cast<size_t>(format)];
+        return slot.done.load(std::memory_order_acquire) && slot.frame != nullptr;
+    }
+} // namespace airplay_streamer
@@ -0,0 +1,841 @@
+// src/video_session.cpp
+
+#include "video_session.hpp"
+#include "avcodec_backend.hpp"
+#include "frame_extras_pool.hpp"
+#include "frame_view_access.hpp"
+#include "h264_utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+}
+
+namespace ender::airplay_streamer {
+    namespace {
+        // 和 raop_ntp_get_local_time 同一个时钟（CLOCK_REALTIME），单位微秒
+        int64_t nowMicros() {
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        const char *shedLevelName(const ShedLevel level) {
+            switch (level) {
+                case ShedLevel::Full: return "full";
+                case ShedLevel::SkipLoopFilter: return "skip loop filter";
+                case ShedLevel::SkipNonRef: return "skip non-reference frames";
+                case ShedLevel::KeyframesOnly: return "keyframes only";
+            }
+            return "unknown";
+        }
+    }
+
+    VideoSession::VideoSession(const uint64_t id, StreamerContext &context)
+        : id_(id), context_(context), config_(context.config),
+          frame_callbacks_(context.hooks.acceptsVideo() || config_.on_video_frame || config_.on_frame_view || config_.on_tensor),
+          shedder_(config_.shedding), queue_(config_.decode_queue_capacity) {
+        // 解码器、帧池和 worker 都等第一个参数集入队时再创建，
+        // 纯音频、配对等不发镜像流的连接不占解码资源
+    }
+
+    VideoSession::~VideoSession() {
+        stopping_.store(true, std::memory_order_release);
+        pushed_.fetch_add(1, std::memory_order_release);
+        pushed_.notify_one();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+        // worker 已经退出，信箱里剩下的帧直接丢弃
+        if (mailbox_) {
+            mailbox_->close();
+        }
+        if (delivery_.joinable()) {
+            delivery_.join();
+        }
+        context_.fanout.endSession(id_);
+
+        AccessUnit unit;
+        while (queue_.tryPop(unit)) {
+            av_buffer_unref(&unit.buffer);
+        }
+        av_buffer_unref(&pending_buffer_);
+
+        log(LogLevel::Info, "session %llu closed: received %llu, decoded %llu, dropped %llu, queue high water %zu/%zu, "
+            "latency avg %lld us max %lld us",
+            static_cast<unsigned long long>(id_),
+            static_cast<unsigned long long>(packets_received_.load()),
+            static_cast<unsigned long long>(frames_decoded_.load()),
+            static_cast<unsigned long long>(packets_dropped_.load()),
+            queue_high_water_.load(), queue_.capacity(),
+            static_cast<long long>(latency_avg_us_.load()), static_cast<long long>(latency_max_us_.load()));
+        if (mailbox_) {
+            log(LogLevel::Info, "session %llu: delivered %llu frames, %llu overwritten in mailbox",
+                static_cast<unsigned long long>(id_),
+                static_cast<unsigned long long>(frames_delivered_.load()),
+                static_cast<unsigned long long>(frames_overwritten_.load()));
+        }
+        if (dirty_tracker_) {
+            log(LogLevel::Info, "session %llu: %llu frames unchanged since the previous delivery%s",
+                static_cast<unsigned long long>(id_),
+                static_cast<unsigned long long>(frames_unchanged_.load()),
+                config_.dirty_tracking.suppress_unchanged ? " (suppressed)" : "");
+        }
+
+        if (frames_decoded_.load() > 0) {
+            log(LogLevel::Info, "session %llu: %s decode time avg %lld us max %lld us, %llu errors",
+                static_cast<unsigned long long>(id_), backend_ ? backend_->name() : "decoder",
+                static_cast<long long>(decode_time_avg_us_.load()), static_cast<long long>(decode_time_max_us_.load()),
+                static_cast<unsigned long long>(decode_errors_.load()));
+        }
+
+        const bool had_decoder = backend_ != nullptr;
+        closeDecoder();
+        // 解码器按打开时的设置回到了池里；正在解码的会话少了一个，下一个会话算出的线程数可能不同，
+        // 按它届时会用的设置补充预热一个（池里已有相同设置时什么都不做）
+        if (had_decoder && !config_.decoder_backend) {
+            context_.decoder_pool.prewarm(context_.decoderSettingsFor(
+                context_.last_width.load(std::memory_order_relaxed),
+                context_.last_height.load(std::memory_order_relaxed), false));
+        }
+    }
+
+    void VideoSession::prewarm() {
+        if (config_.decoder_backend) return;
+        if (!frame_callbacks_ && !context_.fanout.wants(id_)) return;
+        context_.decoder_pool.prewarm(context_.decoderSettingsFor(
+            context_.last_width.load(std::memory_order_relaxed),
+            context_.last_height.load(std::memory_order_relaxed), false));
+    }
+
+    void VideoSession::startWorker() {
+        // 解码器本身由 worker 收到参数集后打开
+        frame_pool_ = FramePool::create();
+
+        if (!config_.output_ladder.divisors.empty()) {
+            ladder_ = std::make_unique<FrameLadder>(frame_pool_, config_.output_ladder.divisors);
+            if (ladder_->empty()) {
+                log(LogLevel::Warning, "session %llu: output ladder has no power-of-two divisors, disabled",
+                    static_cast<unsigned long long>(id_));
+                ladder_.reset();
+            }
+        }
+        if (config_.content_crop.enabled) {
+            content_detector_ = std::make_unique<ContentDetector>(config_.content_crop);
+        }
+        if (config_.export_motion_vectors) {
+            motion_extractor_ = std::make_unique<MotionExtractor>();
+        }
+        if (config_.analytics.enabled) {
+            analyzer_ = std::make_unique<LumaAnalyzer>(config_.analytics);
+        }
+        if (config_.dirty_tracking.enabled) {
+            dirty_tracker_ = std::make_unique<DirtyTracker>(config_.dirty_tracking);
+        }
+        if (config_.on_tensor) {
+            tensor_converter_ = std::make_unique<TensorConverter>(config_.tensor);
+        }
+        view_only_ = config_.on_frame_view && !context_.hooks.acceptsVideo() && !config_.on_video_frame && !config_.on_tensor &&
+                     config_.delivery_mode == DeliveryMode::Direct && !ladder_ && !content_detector_ &&
+                     !dirty_tracker_ && !analyzer_ && !motion_extractor_;
+        if (config_.delivery_mode == DeliveryMode::LatestFrame) {
+            mailbox_ = std::make_unique<FrameMailbox>();
+            delivery_ = std::thread(&VideoSession::deliveryLoop, this);
+        }
+        worker_ = std::thread(&VideoSession::workerLoop, this);
+    }
+
+    bool VideoSession::configureDecoder(const AccessUnit &unit) {
+        const int width = unit.width;
+        const int height = unit.height;
+
+        DecoderParams params = decoderParams(context_.decoderSettingsFor(width, height, backend_ != nullptr), config_);
+        params.avcc = unit.buffer->data;
+        params.avcc_size = static_cast<size_t>(unit.size);
+        params.width = width;
+        params.height = height;
+
+        if (backend_ && backend_->reconfigure(params)) {
+            log(LogLevel::Info, "session %llu: stream format is now %dx%d, decoder reconfigured in place",
+                static_cast<unsigned long long>(id_), width, height);
+            return true;
+        }
+
+        closeDecoder();
+        context_.last_width.store(width, std::memory_order_relaxed);
+        context_.last_height.store(height, std::memory_order_relaxed);
+
+        try {
+            std::unique_ptr<DecoderBackend> backend = config_.decoder_backend
+                                                          ? config_.decoder_backend()
+                                                          : std::make_unique<AvcodecBackend>(context_.decoder_pool);
+            if (!backend) {
+                throw std::runtime_error("Config::decoder_backend returned no backend");
+            }
+            backend->open(params, *this);
+            backend_ = std::move(backend);
+        } catch (const std::exception &e) {
+            log(LogLevel::Error, "session %llu: %s", static_cast<unsigned long long>(id_), e.what());
+            return false;
+        }
+        applyShedLevel();
+        context_.decoding_sessions.fetch_add(1, std::memory_order_relaxed);
+        decoder_threads_.store(params.thread_count, std::memory_order_relaxed);
+        decoder_thread_type_.store(params.thread_type, std::memory_order_relaxed);
+        {
+            std::lock_guard lock(backend_name_mutex_);
+            backend_name_ = backend_->name();
+        }
+
+        log(LogLevel::Info, "session %llu: opened %s decoder for %dx%d, %d thread(s), %s threading",
+            static_cast<unsigned long long>(id_), backend_->name(), width, height,
+            params.thread_count, threadTypeName(params.thread_type));
+        return true;
+    }
+
+    void VideoSession::applyShedLevel() {
+        if (!backend_) return;
+
+        const ShedLevel level = shedder_.level();
+        DecodeSkip skip;
+        skip.loop_filter = level >= ShedLevel::SkipLoopFilter;
+        skip.non_reference = level >= ShedLevel::SkipNonRef;
+        skip.non_key = level >= ShedLevel::KeyframesOnly || config_.sampling.mode == SamplingMode::Keyframes;
+        backend_->setSkip(skip);
+    }
+
+    void VideoSession::closeDecoder() {
+        if (!backend_) return;
+
+        backend_.reset();
+        context_.decoding_sessions.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    unsigned char *VideoSession::acquireBuffer(const int size) {
+        av_buffer_unref(&pending_buffer_);
+        if (size <= 0) return nullptr;
+
+        pending_buffer_ = packet_pool_.acquire(size);
+        return pending_buffer_ ? pending_buffer_->data : nullptr;
+    }
+
+    void VideoSession::process(const h264_decode_struct *data) {
+        // 解密时已经写进了池里的缓冲，直接接管，不再拷贝
+        AVBufferRef *buffer = nullptr;
+        if (pending_buffer_ && data && data->data == pending_buffer_->data) {
+            buffer = pending_buffer_;
+            pending_buffer_ = nullptr;
+        }
+
+        if (!data || !data->data || data->data_len <= 0) {
+            av_buffer_unref(&buffer);
+            return;
+        }
+
+        updateDecoding();
+        const bool decoding = decoding_.load(std::memory_order_relaxed);
+
+        if (data->frame_type == 0) {
+            processConfig(buffer, data);
+            return;
+        }
+        if (stream_config_.avcc.empty()) {
+            // 还没收到 SPS/PPS，送进去也只会报错
+            av_buffer_unref(&buffer);
+            return;
+        }
+        packets_received_.fetch_add(1, std::memory_order_relaxed);
+
+        const auto size = static_cast<size_t>(data->data_len);
+        const auto pts = static_cast<int64_t>(data->pts);
+        const bool keyframe = h264::isKeyframeAvcc(data->data, size);
+        const bool want_annexb = config_.on_video_packet && config_.packet_format == PacketFormat::AnnexB;
+
+        if (!buffer && (decoding || want_annexb)) {
+            // 没能直接解密进池里的缓冲：解码器要持有数据，转换起始码也需要可写的拷贝
+            buffer = packet_pool_.acquire(size);
+            if (!buffer) return;
+            memcpy(buffer->data, data->data, size);
+        }
+
+        // 解码器直接吃 AVCC；只有 on_video_packet 要 Annex-B 时才原地转换，回调完再换回来
+        if (want_annexb) {
+            if (!h264::avccToAnnexB(buffer->data, size, decoding ? &nal_sizes_ : nullptr)) {
+                log(LogLevel::Warning, "session %llu: malformed access unit dropped", static_cast<unsigned long long>(id_));
+                av_buffer_unref(&buffer);
+                return;
+            }
+            deliverPacket(buffer->data, size, PacketFormat::AnnexB, keyframe, pts);
+            if (decoding) h264::annexBToAvcc(buffer->data, nal_sizes_);
+        } else if (config_.on_video_packet) {
+            deliverPacket(buffer ? buffer->data : data->data, size, PacketFormat::Avcc, keyframe, pts);
+        }
+
+        if (!decoding) {
+            av_buffer_unref(&buffer);
+            return;
+        }
+
+        if (waiting_for_keyframe_) {
+            if (!keyframe) {
+                packets_dropped_.fetch_add(1, std::memory_order_relaxed);
+                av_buffer_unref(&buffer);
+                return;
+            }
+            waiting_for_keyframe_ = false;
+            log(LogLevel::Info, "session %llu: keyframe arrived, resuming decode", static_cast<unsigned long long>(id_));
+        }
+
+        AccessUnit unit;
+        unit.keyframe = keyframe;
+        unit.buffer = buffer;
+        unit.size = data->data_len;
+        unit.pts = pts;
+        if (!admit(unit)) {
+            packets_skipped_.fetch_add(1, std::memory_order_relaxed);
+            av_buffer_unref(&unit.buffer);
+            return;
+        }
+        enqueue(unit, false);
+    }
+
+    bool VideoSession::admit(AccessUnit &unit) {
+        switch (config_.sampling.mode) {
+            case SamplingMode::Keyframes:
+                return unit.keyframe;
+            case SamplingMode::Interval: {
+                // 时间戳还没同步时用本地时间决定，并作为这一帧交付时的时间戳
+                const int64_t now = unit.pts > 0 ? unit.pts : nowMicros();
+                unit.pts = now;
+                const int64_t interval = static_cast<int64_t>(std::max(config_.sampling.interval_ms, 1)) * 1000;
+                unit.sample = now >= next_sample_us_;
+                if (unit.sample) {
+                    // 按固定间隔推进，落后超过一个间隔（断流、丢帧）时从当前时间重新开始
+                    next_sample_us_ = now - next_sample_us_ >= interval ? now + interval : next_sample_us_ + interval;
+                    return true;
+                }
+                // 不交付的帧只有被后面的帧参考时才需要解码
+                return h264::isReferenceAvcc(unit.buffer->data, unit.size);
+            }
+            case SamplingMode::All:
+            default:
+                return true;
+        }
+    }
+
+    bool VideoSession::sampled(AVFrame *frame) {
+        // 没有 B 帧，解码器按送入顺序输出；被解码器丢掉的包不会输出，对应的记录在这里顺带清掉
+        const int64_t seq = frame->pts;
+        while (!pending_samples_.empty() && pending_samples_.front().seq < seq) pending_samples_.pop_front();
+        if (pending_samples_.empty() || pending_samples_.front().seq != seq) return false;
+        const PendingSample pending = pending_samples_.front();
+        pending_samples_.pop_front();
+        frame->pts = pending.pts;
+        return pending.sample;
+    }
+
+    void VideoSession::processConfig(AVBufferRef *buffer, const h264_decode_struct *data) {
+        av_buffer_unref(&buffer);
+
+        h264::AvcConfig config;
+        if (!h264::parseAvcC(data->data, data->data_len, config) ||
+            config.nal_length_size != static_cast<int>(h264::kAvccLengthSize)) {
+            log(LogLevel::Warning, "session %llu: unsupported avcC record (%d bytes)",
+                static_cast<unsigned long long>(id_), data->data_len);
+            return;
+        }
+        // 发送端重连或重发相同的参数时什么都不用做
+        if (config.avcc == stream_config_.avcc && data->width == stream_width_ && data->height == stream_height_ &&
+            data->source_width == source_width_ && data->source_height == source_height_) {
+            return;
+        }
+        stream_config_ = std::move(config);
+        stream_width_ = data->width;
+        stream_height_ = data->height;
+        source_width_ = data->source_width;
+        source_height_ = data->source_height;
+        config_changed_ = true;
+
+        if (!decoding_.load(std::memory_order_relaxed)) {
+            notifyFormat(stream_config_.avcc.data(), stream_config_.avcc.size(), stream_width_, stream_height_,
+                         source_width_, source_height_);
+            return;
+        }
+
+        // 在第一个 IDR 之前就让 worker 把解码器和帧池准备好
+        enqueueConfig(true);
+    }
+
+    void VideoSession::enqueueConfig(const bool notify) {
+        AccessUnit unit;
+        unit.kind = AccessUnit::Kind::Config;
+        unit.notify = notify;
+        unit.width = stream_width_;
+        unit.height = stream_height_;
+        unit.source_width = source_width_;
+        unit.source_height = source_height_;
+        unit.size = static_cast<int>(stream_config_.avcc.size());
+        unit.buffer = packet_pool_.acquire(stream_config_.avcc.size());
+        if (!unit.buffer) return;
+        memcpy(unit.buffer->data, stream_config_.avcc.data(), stream_config_.avcc.size());
+        enqueue(unit, true);
+    }
+
+    void VideoSession::updateDecoding() {
+        bool wanted = frame_callbacks_;
+        if (!wanted) {
+            // 订阅者列表没变时不用重新遍历
+            const uint64_t version = context_.fanout.version();
+            if (version != fanout_version_) {
+                fanout_version_ = version;
+                fanout_wants_ = context_.fanout.wants(id_);
+            }
+            wanted = fanout_wants_;
+        }
+        if (wanted == decoding_.load(std::memory_order_relaxed)) return;
+        decoding_.store(wanted, std::memory_order_relaxed);
+
+        if (!wanted) {
+            // 最后一个订阅者走了，也没有逐帧回调：关掉解码器，之后的包不再入队
+            if (worker_.joinable()) {
+                AccessUnit unit;
+                unit.kind = AccessUnit::Kind::Close;
+                enqueue(unit, true);
+            }
+            log(LogLevel::Info, "session %llu: no consumer needs frames, decoding stopped",
+                static_cast<unsigned long long>(id_));
+            return;
+        }
+        // 还没收到参数集时由 processConfig 照常入队
+        if (stream_config_.avcc.empty()) return;
+
+        // 流已经开始了：按当前参数集打开解码器，从下一个关键帧开始解码
+        log(LogLevel::Info, "session %llu: frames requested, decoding from the next keyframe",
+            static_cast<unsigned long long>(id_));
+        enqueueConfig(false);
+        waiting_for_keyframe_ = true;
+    }
+
+    void VideoSession::notifyFormat(const uint8_t *avcc, const size_t avcc_size, const int width, const int height,
+                                    const int source_width, const int source_height) const {
+        if (!config_.on_stream_format_changed) return;
+
+        StreamFormat format;
+        format.session_id = id_;
+        format.width = width;
+        format.height = height;
+        format.source_width = source_width;
+        format.source_height = source_height;
+        // 发送端旋转屏幕时源尺寸的宽高会对调；没有源尺寸时按编码尺寸判断
+        const bool portrait = source_width > 0 && source_height > 0
+                                  ? source_height > source_width
+                                  : height > width;
+        format.orientation = portrait ? Orientation::Portrait : Orientation::Landscape;
+        format.profile = avcc_size > 3 ? avcc[1] : 0;
+        format.level = avcc_size > 3 ? avcc[3] : 0;
+        format.avcc = avcc;
+        format.avcc_size = avcc_size;
+        config_.on_stream_format_changed(format);
+    }
+
+    void VideoSession::deliverPacket(const uint8_t *data, const size_t size, const PacketFormat format,
+                                     const bool keyframe, const int64_t pts) {
+        const auto &config = format == PacketFormat::Avcc ? stream_config_.avcc : stream_config_.annexb;
+
+        VideoPacket packet;
+        packet.session_id = id_;
+        packet.data = data;
+        packet.size = size;
+        packet.format = format;
+        packet.pts = pts;
+        packet.keyframe = keyframe;
+        packet.config = config.data();
+        packet.config_size = config.size();
+        packet.config_changed = config_changed_;
+        config_changed_ = false;
+
+        config_.on_video_packet(packet);
+    }
+
+    void VideoSession::enqueue(AccessUnit &unit, const bool must_deliver) {
+        if (!worker_.joinable()) {
+            startWorker();
+        }
+        while (!queue_.tryPush(unit)) {
+            if (!must_deliver) {
+                // 丢掉一个参考帧之后后续 P 帧都没法正确解码，索性等下一个关键帧
+                av_buffer_unref(&unit.buffer);
+                packets_dropped_.fetch_add(1, std::memory_order_relaxed);
+                waiting_for_keyframe_ = true;
+                log(LogLevel::Warning, "session %llu: decode queue full (%zu), dropping until next keyframe",
+                    static_cast<unsigned long long>(id_), queue_.capacity());
+                return;
+            }
+            // SPS/PPS 不能丢，等 worker 腾出位置
+            const uint32_t seen = consumed_.load(std::memory_order_acquire);
+            if (queue_.tryPush(unit)) break;
+            if (stopping_.load(std::memory_order_acquire)) {
+                av_buffer_unref(&unit.buffer);
+                return;
+            }
+            consumed_.wait(seen, std::memory_order_acquire);
+        }
+
+        const size_t depth = queue_.size();
+        size_t high_water = queue_high_water_.load(std::memory_order_relaxed);
+        while (depth > high_water &&
+               !queue_high_water_.compare_exchange_weak(high_water, depth, std::memory_order_relaxed)) {
+        }
+
+        pushed_.fetch_add(1, std::memory_order_release);
+        pushed_.notify_one();
+    }
+
+    void VideoSession::flush() {
+        // worker 还没启动时解码器里没有帧
+        if (!worker_.joinable()) return;
+
+        AccessUnit unit;
+        unit.kind = AccessUnit::Kind::Flush;
+        enqueue(unit, true);
+    }
+
+    void VideoSession::workerLoop() {
+        AccessUnit unit;
+        while (true) {
+            const uint32_t seen = pushed_.load(std::memory_order_acquire);
+            if (stopping_.load(std::memory_order_acquire)) break;
+
+            if (!queue_.tryPop(unit)) {
+                pushed_.wait(seen, std::memory_order_acquire);
+                continue;
+            }
+            consumed_.fetch_add(1, std::memory_order_release);
+            consumed_.notify_one();
+
+            handle(unit);
+        }
+    }
+
+    void VideoSession::handle(AccessUnit &unit) {
+        switch (unit.kind) {
+            case AccessUnit::Kind::Config:
+                if (configureDecoder(unit) && unit.notify) {
+                    notifyFormat(unit.buffer->data, unit.size, unit.width, unit.height,
+                                 unit.source_width, unit.source_height);
+                }
+                av_buffer_unref(&unit.buffer);
+                break;
+            case AccessUnit::Kind::Video:
+                if (backend_) {
+                    const ShedLevel previous = shedder_.level();
+                    const int64_t lag_us = unit.pts > 0 ? nowMicros() - unit.pts : -1;
+                    if (shedder_.update(queue_.size(), queue_.capacity(), lag_us, unit.keyframe)) {
+                        const ShedLevel level = shedder_.level();
+                        applyShedLevel();
+                        shed_level_.store(level, std::memory_order_relaxed);
+                        (level > previous ? shed_escalations_ : shed_recoveries_).fetch_add(1, std::memory_order_relaxed);
+                        log(level > previous ? LogLevel::Warning : LogLevel::Info,
+                            "session %llu: decode %s, now %s (queue %zu/%zu, lag %lld ms)",
+                            static_cast<unsigned long long>(id_), level > previous ? "falling behind" : "caught up",
+                            shedLevelName(level), queue_.size(), queue_.capacity(),
+                            static_cast<long long>(lag_us / 1000));
+                    }
+                    if (config_.sampling.mode == SamplingMode::Interval) {
+                        const int64_t seq = ++decode_seq_;
+                        pending_samples_.push_back({seq, unit.pts, unit.sample});
+                        decode(unit.buffer, unit.size, seq);
+                    } else {
+                        decode(unit.buffer, unit.size, unit.pts);
+                    }
+                } else {
+                    av_buffer_unref(&unit.buffer);
+                }
+                break;
+            case AccessUnit::Kind::Flush:
+                if (backend_) backend_->flush();
+                pending_samples_.clear();
+                break;
+            case AccessUnit::Kind::Close:
+                // 解码器回到池里，重新需要帧时再按参数集打开
+                closeDecoder();
+                pending_samples_.clear();
+                break;
+        }
+        unit.buffer = nullptr;
+    }
+
+    void VideoSession::decode(AVBufferRef *buffer, const int size, const int64_t pts) {
+        const auto start = std::chrono::steady_clock::now();
+        const int ret = backend_->decode(buffer, size, pts);
+        const int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        // 只有 worker 一个线程写
+        const int64_t avg = decode_time_avg_us_.load(std::memory_order_relaxed);
+        decode_time_avg_us_.store(avg == 0 ? elapsed : avg + (elapsed - avg) / 16, std::memory_order_relaxed);
+        if (elapsed > decode_time_max_us_.load(std::memory_order_relaxed)) {
+            decode_time_max_us_.store(elapsed, std::memory_order_relaxed);
+        }
+        if (ret < 0) {
+            decode_errors_.fetch_add(1, std::memory_order_relaxed);
+            log(LogLevel::Debug, "session %llu: %s failed to decode a packet (%d)",
+                static_cast<unsigned long long>(id_), backend_->name(), ret);
+        }
+    }
+
+    int VideoSession::allocate(AVFrame *frame) {
+        return frame_pool_->allocate(frame);
+    }
+
+    void VideoSession::attach(AVCodecContext *ctx) {
+        frame_pool_->attach(ctx);
+    }
+
+    void VideoSession::reserve(AVCodecContext *ctx, const int width, const int height, const int count) {
+        frame_pool_->reserve(ctx, width, height, count);
+    }
+
+    void VideoSession::emit(AVFrame *frame) {
+        frames_decoded_.fetch_add(1, std::memory_order_relaxed);
+
+        // 开了帧线程时输出的帧不一定是刚送进去的那个包，时间戳以帧上的为准
+        if (config_.sampling.mode == SamplingMode::Interval && !sampled(frame)) {
+            // 只是为了后续帧的参考才解码的帧
+            av_frame_unref(frame);
+            return;
+        }
+        const int64_t frame_pts = frame->pts;
+
+        if (view_only_ && context_.fanout.empty()) {
+            deliverView(frame, frame_pts);
+            av_frame_unref(frame);
+            return;
+        }
+
+        // 帧外壳和控制块都来自池，用户释放最后一个引用后自动回收
+        auto shared_frame = frame_pool_->wrap(frame);
+        if (!shared_frame) return;
+
+        if (!mailbox_) {
+            deliver(std::move(shared_frame), frame_pts);
+        } else if (mailbox_->put(std::move(shared_frame), frame_pts)) {
+            frames_overwritten_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void VideoSession::deliver(std::shared_ptr<AVFrame> frame, const int64_t pts) {
+        if (motion_extractor_) {
+            // 在裁剪之前取，运动矢量的坐标对应解码器输出的整帧
+            motion_extractor_->extract(frame.get(), motion_);
+        }
+        if (content_detector_) {
+            cropContent(frame.get());
+        }
+        if (analyzer_) {
+            // 在去重之前统计，被 suppress_unchanged 跳过的帧也计入静止帧数
+            analyze(frame.get());
+        }
+        if (dirty_tracker_) {
+            // 与上一次交付的帧比较，LatestFrame 模式下被覆盖的帧不参与
+            if (dirty_tracker_->compare(frame.get(), tiles_)) {
+                dirty_tracker_->accept(frame);
+            } else {
+                frames_unchanged_.fetch_add(1, std::memory_order_relaxed);
+                if (config_.dirty_tracking.suppress_unchanged) return;
+            }
+        }
+        if (ladder_) {
+            frame = attachLadder(std::move(frame));
+        }
+        if (dirty_tracker_ || analytics_.computed || motion_extractor_) {
+            if (FrameExtras *extras = attachFrameExtras(frame.get())) {
+                if (dirty_tracker_) std::swap(extras->tiles, tiles_);
+                if (motion_extractor_) std::swap(extras->motion, motion_);
+                extras->analytics = analytics_;
+            }
+        }
+        if (config_.on_video_frame) {
+            config_.on_video_frame(VideoFrame::create(frame, pts));
+        }
+        if (tensor_converter_) {
+            if (auto tensor = tensor_converter_->convert(frame.get(), pts, id_, config_.tensor_allocator)) {
+                config_.on_tensor(std::move(tensor));
+            }
+        }
+        if (config_.on_frame_view) {
+            FrameView view;
+            FrameViewAccess::fill(view, frame.get(), pts, id_, frame_pool_.get());
+            config_.on_frame_view(view);
+        }
+        if (!context_.fanout.empty()) {
+            context_.fanout.publish(frame, pts, id_);
+        }
+        if (const SinkHooks &hooks = context_.hooks; hooks.acceptsVideo()) {
+            hooks.onVideo(std::move(frame), pts);
+        }
+        frames_delivered_.fetch_add(1, std::memory_order_relaxed);
+        recordLatency(pts);
+    }
+
+    void VideoSession::deliverView(const AVFrame *frame, const int64_t pts) {
+        FrameView view;
+        FrameViewAccess::fill(view, frame, pts, id_, frame_pool_.get());
+        config_.on_frame_view(view);
+        frames_delivered_.fetch_add(1, std::memory_order_relaxed);
+        recordLatency(pts);
+    }
+
+    void VideoSession::cropContent(AVFrame *frame) {
+        if (content_detector_->update(frame)) {
+            const ContentRect &rect = content_detector_->rect();
+            content_left_.store(rect.left, std::memory_order_relaxed);
+            content_top_.store(rect.top, std::memory_order_relaxed);
+            content_width_.store(rect.width, std::memory_order_relaxed);
+            content_height_.store(rect.height, std::memory_order_relaxed);
+            log(LogLevel::Info, "session %llu: content area %dx%d at (%d, %d) in %dx%d frame",
+                static_cast<unsigned long long>(id_), rect.width, rect.height, rect.left, rect.top,
+                frame->width, frame->height);
+        }
+        if (!content_detector_->cropped()) return;
+
+        const ContentRect &rect = content_detector_->rect();
+        frame->crop_left = rect.left;
+        frame->crop_top = rect.top;
+        frame->crop_right = frame->width - rect.left - rect.width;
+        frame->crop_bottom = frame->height - rect.top - rect.height;
+        if (!config_.content_crop.apply) return;
+
+        // 帧还没交给任何人，直接在原外壳上移动数据指针；偏移保持偶数，色度平面也能精确对齐
+        if (av_frame_apply_cropping(frame, AV_FRAME_CROP_UNALIGNED) < 0) {
+            frame->crop_left = frame->crop_top = frame->crop_right = frame->crop_bottom = 0;
+        }
+    }
+
+    void VideoSession::analyze(const AVFrame *frame) {
+        if (!analyzer_->analyze(frame, analytics_)) return;
+
+        frames_analyzed_.fetch_add(1, std::memory_order_relaxed);
+        luma_mean_.store(analytics_.mean, std::memory_order_relaxed);
+        if (analytics_.blank) blank_frames_.fetch_add(1, std::memory_order_relaxed);
+        if (analytics_.unchanged) {
+            unchanged_run_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            unchanged_run_.store(0, std::memory_order_relaxed);
+        }
+
+        if (analytics_.black) black_frames_.fetch_add(1, std::memory_order_relaxed);
+        // 只在进入/离开黑屏时记一条日志
+        if (analytics_.black != screen_black_) {
+            screen_black_ = analytics_.black;
+            log(LogLevel::Info, "session %llu: screen %s black (mean luma %.1f)",
+                static_cast<unsigned long long>(id_), analytics_.black ? "went" : "no longer", analytics_.mean);
+        }
+    }
+
+    std::shared_ptr<AVFrame> VideoSession::attachLadder(std::shared_ptr<AVFrame> frame) {
+        // 放在交付时做：LatestFrame 模式下被覆盖的帧不用缩放
+        if (!ladder_->build(frame, ladder_frames_)) return frame;
+
+        std::shared_ptr<AVFrame> delivered = std::move(frame);
+        if (!config_.output_ladder.deliver_full) {
+            // 交付第一级：用一个新外壳引用它，避免帧通过 FrameExtras 引用自己
+            auto primary = frame_pool_->share(ladder_frames_.front().get());
+            if (!primary) {
+                ladder_frames_.clear();
+                return delivered;
+            }
+            delivered = std::move(primary);
+        }
+
+        if (FrameExtras *extras = attachFrameExtras(delivered.get())) {
+            extras->ladder.swap(ladder_frames_);
+        }
+        ladder_frames_.clear();
+        return delivered;
+    }
+
+    void VideoSession::deliveryLoop() {
+        std::shared_ptr<AVFrame> frame;
+        int64_t pts = 0;
+        while (mailbox_->take(frame, pts)) {
+            deliver(std::move(frame), pts);
+            frame.reset();
+        }
+    }
+
+    void VideoSession::recordLatency(const int64_t pts) {
+        // pts 是换算到本机 CLOCK_REALTIME 的微秒时间
+        if (pts <= 0) return;
+
+        const int64_t latency = std::max<int64_t>(0, nowMicros() - pts);
+
+        // 只有负责回调的那一个线程写，读写不需要 CAS
+        const int64_t avg = latency_avg_us_.load(std::memory_order_relaxed);
+        latency_avg_us_.store(avg == 0 ? latency : avg + (latency - avg) / 16, std::memory_order_relaxed);
+        latency_last_us_.store(latency, std::memory_order_relaxed);
+        if (latency > latency_max_us_.load(std::memory_order_relaxed)) {
+            latency_max_us_.store(latency, std::memory_order_relaxed);
+        }
+    }
+
+    SessionStats VideoSession::stats() const {
+        SessionStats stats;
+        stats.session_id = id_;
+        stats.decoding = decoding_.load(std::memory_order_relaxed);
+        stats.decoder_threads = decoder_threads_.load(std::memory_order_relaxed);
+        stats.decoder_thread_type = decoder_thread_type_.load(std::memory_order_relaxed);
+        {
+            std::lock_guard lock(backend_name_mutex_);
+            stats.decoder_backend = backend_name_;
+        }
+        stats.decode_time_avg_us = decode_time_avg_us_.load(std::memory_order_relaxed);
+        stats.decode_time_max_us = decode_time_max_us_.load(std::memory_order_relaxed);
+        stats.decode_errors = decode_errors_.load(std::memory_order_relaxed);
+        stats.shed_level = shed_level_.load(std::memory_order_relaxed);
+        stats.shed_escalations = shed_escalations_.load(std::memory_order_relaxed);
+        stats.shed_recoveries = shed_recoveries_.load(std::memory_order_relaxed);
+        stats.queue_depth = queue_.size();
+        stats.queue_high_water = queue_high_water_.load(std::memory_order_relaxed);
+        stats.queue_capacity = queue_.capacity();
+        stats.packets_received = packets_received_.load(std::memory_order_relaxed);
+        stats.packets_dropped = packets_dropped_.load(std::memory_order_relaxed);
+        stats.frames_decoded = frames_decoded_.load(std::memory_order_relaxed);
+        stats.frames_delivered = frames_delivered_.load(std::memory_order_relaxed);
+        stats.packets_skipped = packets_skipped_.load(std::memory_order_relaxed);
+        stats.frames_overwritten = frames_overwritten_.load(std::memory_order_relaxed);
+        stats.frames_unchanged = frames_unchanged_.load(std::memory_order_relaxed);
+        stats.frames_analyzed = frames_analyzed_.load(std::memory_order_relaxed);
+        stats.black_frames = black_frames_.load(std::memory_order_relaxed);
+        stats.blank_frames = blank_frames_.load(std::memory_order_relaxed);
+        stats.unchanged_run = unchanged_run_.load(std::memory_order_relaxed);
+        stats.luma_mean = luma_mean_.load(std::memory_order_relaxed);
+        stats.content_left = content_left_.load(std::memory_order_relaxed);
+        stats.content_top = content_top_.load(std::memory_order_relaxed);
+        stats.content_width = content_width_.load(std::memory_order_relaxed);
+        stats.content_height = content_height_.load(std::memory_order_relaxed);
+        stats.latency_last_us = latency_last_us_.load(std::memory_order_relaxed);
+        stats.latency_avg_us = latency_avg_us_.load(std::memory_order_relaxed);
+        stats.latency_max_us = latency_max_us_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void VideoSession::log(const LogLevel level, const char *format, ...) const {
+        const SinkHooks &hooks = context_.hooks;
+        if (!hooks.acceptsLog()) return;
+
+        char message[512];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(message, sizeof(message), format, args);
+        va_end(args);
+        hooks.onLog(level, message);
+    }
+} // namespace airplay_streamer
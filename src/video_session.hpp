@@ -0,0 +1,259 @@
+// src/video_session.hpp
+#pragma once
+
+#include <airplay_streamer.hpp>
+#include "decode_shedder.hpp"
+#include <decoder_backend.hpp>
+#include "decoder_settings.hpp"
+#include "content_detector.hpp"
+#include "dirty_tracker.hpp"
+#include "frame_ladder.hpp"
+#include "frame_mailbox.hpp"
+#include "luma_analyzer.hpp"
+#include "motion_extractor.hpp"
+#include "tensor_converter.hpp"
+#include "frame_pool.hpp"
+#include "h264_utils.hpp"
+#include "packet_pool.hpp"
+#include "spsc_queue.hpp"
+#include "streamer_context.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "stream.h"
+}
+
+struct AVBufferRef;
+struct AVCodecContext;
+struct AVPacket;
+struct AVFrame;
+
+namespace ender::airplay_streamer {
+    // 从 mirror 线程交给解码线程的一帧数据，buffer 的所有权随队列转移
+    struct AccessUnit {
+        enum class Kind : uint8_t {
+            Video,
+            Config,
+            Flush,
+            Close // 不再需要解码帧，关闭解码器
+        };
+
+        Kind kind = Kind::Video;
+        bool keyframe = false;
+        bool sample = true; // SamplingMode::Interval 下这一帧解码后是否交付
+        bool notify = true; // Config：打开解码器后是否回调 on_stream_format_changed（之前不解码时已经回调过）
+        AVBufferRef *buffer = nullptr;
+        int size = 0;
+        int64_t pts = 0;
+
+        // 只有 Config 有效：buffer 里是 avcC 记录，以下是编码分辨率和发送端屏幕尺寸
+        int width = 0;
+        int height = 0;
+        int source_width = 0;
+        int source_height = 0;
+    };
+
+    // 单个 AirPlay 连接的视频状态：每个 raop_conn_t 独占一个解码器和解码线程。
+    // mirror 线程只负责收包解密后入队，解码和回调在 worker 线程上进行，
+    // 慢解码或慢消费者不会阻塞 TCP 接收。worker 在第一个参数集入队时才启动。
+    // 是否解码在每个包上由 updateDecoding 决定：设置了 on_video_data / on_video_frame / on_frame_view / on_tensor，
+    // 或者有订阅者（回调、FrameQueue、FrameStream）接收这个会话的帧时解码，否则只走 on_video_packet。
+    // 订阅者来去时在下一个包上打开或关闭解码器
+    class VideoSession final : DecoderOutput {
+    public:
+        VideoSession(uint64_t id, StreamerContext &context);
+
+        ~VideoSession();
+
+        VideoSession(const VideoSession &) = delete;
+
+        VideoSession &operator=(const VideoSession &) = delete;
+
+        uint64_t id() const { return id_; }
+
+        // 由 mirror 线程调用，返回下一帧解密数据的落点，随后的 process 会直接接管这块缓冲
+        unsigned char *acquireBuffer(int size);
+
+        // 由 mirror 线程调用，frame_type 0 为 SPS/PPS，1 为视频帧
+        void process(const h264_decode_struct *data);
+
+        // 由连接线程在 mirror SETUP 时调用：这个会话会解码时，按上次的分辨率在池里预热一个解码器，
+        // 启动后的第一个会话也不用在收到参数集后现场打开
+        void prewarm();
+
+        // 丢弃解码器内部缓存的帧，和 process 一样占用生产者端，
+        // 只能在 mirror 线程上或 mirror 线程退出之后调用
+        void flush();
+
+        SessionStats stats() const;
+
+    private:
+        // 按新的流参数打开解码后端；后端能原地切换时不重开
+        bool configureDecoder(const AccessUnit &unit);
+
+        void notifyFormat(const uint8_t *avcc, size_t avcc_size, int width, int height,
+                          int source_width, int source_height) const;
+
+        void closeDecoder();
+
+        void recordLatency(int64_t pts);
+
+        // 按 shedder_ 当前级别和抽样方式设置后端要跳过的工作
+        void applyShedLevel();
+
+        // 把一帧交给 on_video_data / on_video_frame，Direct 模式在 worker 上、LatestFrame 模式在 delivery 线程上调用
+        void deliver(std::shared_ptr<AVFrame> frame, int64_t pts);
+
+        // 只有 on_frame_view 时的快速路径：直接借出解码器输出的帧
+        void deliverView(const AVFrame *frame, int64_t pts);
+
+        void deliveryLoop();
+
+        // mirror 线程上按 Sampling 决定这一帧是否入队，unit.sample 记录是否交付
+        bool admit(AccessUnit &unit);
+
+        // Interval 模式下解码输出的帧是否该交付；frame->pts 是送入时的序号，这里换回真实时间戳
+        bool sampled(AVFrame *frame);
+
+        // 生成 OutputLadder 各级并挂到帧上，返回实际要交付的帧
+        std::shared_ptr<AVFrame> attachLadder(std::shared_ptr<AVFrame> frame);
+
+        // 按检测到的画面区域设置（或直接应用）frame 的裁剪；frame 此时只有 deliver() 持有
+        void cropContent(AVFrame *frame);
+
+        // 计算亮度统计并计入会话统计
+        void analyze(const AVFrame *frame);
+
+        void processConfig(AVBufferRef *buffer, const h264_decode_struct *data);
+
+        // mirror 线程上每个包调用一次：按回调和订阅者决定是否解码，状态变化时通知 worker
+        void updateDecoding();
+
+        // 把当前参数集交给 worker 打开解码器
+        void enqueueConfig(bool notify);
+
+        void deliverPacket(const uint8_t *data, size_t size, PacketFormat format, bool keyframe, int64_t pts);
+
+        // 第一次入队时创建帧池、交付用的辅助对象并启动 worker（和 delivery）线程
+        void startWorker();
+
+        void enqueue(AccessUnit &unit, bool must_deliver);
+
+        void workerLoop();
+
+        void handle(AccessUnit &unit);
+
+        void decode(AVBufferRef *buffer, int size, int64_t pts);
+
+        // DecoderOutput：后端的帧缓冲来自 frame_pool_，解码出的帧在这里交付
+        int allocate(AVFrame *frame) override;
+
+        void attach(AVCodecContext *ctx) override;
+
+        void reserve(AVCodecContext *ctx, int width, int height, int count) override;
+
+        void emit(AVFrame *frame) override;
+
+        void log(LogLevel level, const char *format, ...) const;
+
+        const uint64_t id_;
+        StreamerContext &context_;
+        const Config &config_;
+        const bool frame_callbacks_; // 设置了逐帧回调，始终需要解码
+        std::atomic<bool> decoding_{false}; // 只有 mirror 线程写
+
+        // 以下只在 worker 线程上访问
+        std::unique_ptr<DecoderBackend> backend_;
+        std::shared_ptr<FramePool> frame_pool_;
+        DecodeShedder shedder_;
+
+        // Interval 抽样：送进解码器的包以序号代替时间戳，输出时按序号找回时间戳和是否交付。
+        // 帧线程下输出的帧不一定是刚送进去的包，而未同步时的时间戳（0）无法区分不同的帧
+        struct PendingSample {
+            int64_t seq;
+            int64_t pts;
+            bool sample;
+        };
+
+        std::deque<PendingSample> pending_samples_;
+        int64_t decode_seq_ = 0;
+
+        // 以下只在 mirror 线程上访问
+        PacketPool packet_pool_;
+        AVBufferRef *pending_buffer_ = nullptr;
+        h264::AvcConfig stream_config_;
+        int stream_width_ = 0;
+        int stream_height_ = 0;
+        int source_width_ = 0;
+        int source_height_ = 0;
+        std::vector<uint32_t> nal_sizes_; // Annex-B 转换的临时记录
+        bool config_changed_ = false;
+        bool waiting_for_keyframe_ = false;
+        uint64_t fanout_version_ = ~uint64_t{0};
+        bool fanout_wants_ = false;
+        int64_t next_sample_us_ = 0;
+
+        SpscQueue<AccessUnit> queue_;
+        std::atomic<uint32_t> pushed_{0};   // 生产者每入队一次加一，用于唤醒 worker
+        std::atomic<uint32_t> consumed_{0}; // 消费者每出队一次加一，用于唤醒阻塞的生产者
+        std::atomic<bool> stopping_{false};
+        std::thread worker_;
+
+        // LatestFrame 模式下 worker 把帧放进信箱，由 delivery 线程回调
+        std::unique_ptr<FrameMailbox> mailbox_;
+        std::thread delivery_;
+
+        // 以下只在负责回调的线程上访问
+        std::unique_ptr<FrameLadder> ladder_;
+        std::vector<std::shared_ptr<AVFrame>> ladder_frames_;
+        std::unique_ptr<TensorConverter> tensor_converter_;
+        std::unique_ptr<DirtyTracker> dirty_tracker_;
+        std::unique_ptr<ContentDetector> content_detector_;
+        std::unique_ptr<LumaAnalyzer> analyzer_;
+        FrameAnalytics analytics_;
+        std::unique_ptr<MotionExtractor> motion_extractor_;
+        bool view_only_ = false; // on_frame_view 是唯一的逐帧消费者
+        MotionField motion_;
+        bool screen_black_ = false;
+        TileMap tiles_;
+
+        std::atomic<uint64_t> packets_received_{0};
+        std::atomic<uint64_t> packets_dropped_{0};
+        std::atomic<uint64_t> packets_skipped_{0};
+        std::atomic<uint64_t> frames_decoded_{0};
+        std::atomic<uint64_t> frames_delivered_{0};
+        std::atomic<uint64_t> frames_overwritten_{0};
+        std::atomic<uint64_t> frames_unchanged_{0};
+        std::atomic<uint64_t> frames_analyzed_{0};
+        std::atomic<uint64_t> black_frames_{0};
+        std::atomic<uint64_t> blank_frames_{0};
+        std::atomic<uint64_t> unchanged_run_{0};
+        std::atomic<float> luma_mean_{0.0f};
+        std::atomic<int> content_left_{0};
+        std::atomic<int> content_top_{0};
+        std::atomic<int> content_width_{0};
+        std::atomic<int> content_height_{0};
+        std::atomic<int64_t> latency_last_us_{0};
+        std::atomic<int64_t> latency_avg_us_{0};
+        std::atomic<int64_t> latency_max_us_{0};
+        std::atomic<size_t> queue_high_water_{0};
+        std::atomic<int> decoder_threads_{0};
+        std::atomic<DecoderThreadType> decoder_thread_type_{DecoderThreadType::Auto};
+        std::atomic<int64_t> decode_time_avg_us_{0};
+        std::atomic<int64_t> decode_time_max_us_{0};
+        std::atomic<uint64_t> decode_errors_{0};
+        mutable std::mutex backend_name_mutex_;
+        std::string backend_name_;
+        std::atomic<ShedLevel> shed_level_{ShedLevel::Full};
+        std::atomic<uint64_t> shed_escalations_{0};
+        std::atomic<uint64_t> shed_recoveries_{0};
+    };
+} // namespace airplay_streamer
@@ -0,0 +1,244 @@
+// src/yuv_convert.cpp
+
+#include "yuv_convert.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AIRPLAY_YUV_SSE2 1
+#endif
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace ender::airplay_streamer::yuv {
+    namespace {
+        constexpr Coefficients kBt601Limited{16, 2385, 3269, -802, -1665, 4131};
+        constexpr Coefficients kBt709Limited{16, 2385, 3672, -437, -1091, 4326};
+        constexpr Coefficients kBt601Full{0, 2048, 2871, -705, -1463, 3629};
+        constexpr Coefficients kBt709Full{0, 2048, 3225, -384, -959, 3800};
+
+        // 与 _mm_mulhi_epi16 相同的算术，保证 SIMD 和标量结果一致
+        inline int mulhi(const int a, const int b) {
+            return (a * b) >> 16;
+        }
+
+        // 1/4 单位四舍五入后截到 0..255
+        inline uint8_t clamp8(const int v) {
+            return static_cast<uint8_t>(std::clamp((v + 2) >> 2, 0, 255));
+        }
+
+        void bgraRowScalar(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst,
+                           const int begin, const int width, const Coefficients &k) {
+            for (int x = begin; x < width; ++x) {
+                const int yy = mulhi((y[x] - k.y_offset) << 7, k.y);
+                const int uu = (u[x >> 1] - 128) << 7;
+                const int vv = (v[x >> 1] - 128) << 7;
+                dst[4 * x] = clamp8(yy + mulhi(uu, k.u_b));
+                dst[4 * x + 1] = clamp8(yy + mulhi(uu, k.u_g) + mulhi(vv, k.v_g));
+                dst[4 * x + 2] = clamp8(yy + mulhi(vv, k.v_r));
+                dst[4 * x + 3] = 255;
+            }
+        }
+
+        void planarRowScalar(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *r, uint8_t *g,
+                             uint8_t *b, const int begin, const int width, const Coefficients &k) {
+            for (int x = begin; x < width; ++x) {
+                const int yy = mulhi((y[x] - k.y_offset) << 7, k.y);
+                const int uu = (u[x] - 128) << 7;
+                const int vv = (v[x] - 128) << 7;
+                r[x] = clamp8(yy + mulhi(vv, k.v_r));
+                g[x] = clamp8(yy + mulhi(uu, k.u_g) + mulhi(vv, k.v_g));
+                b[x] = clamp8(yy + mulhi(uu, k.u_b));
+            }
+        }
+
+#ifdef AIRPLAY_YUV_SSE2
+        int planarRowSse2(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *r, uint8_t *g, uint8_t *b,
+                          const int width, const Coefficients &k) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i y_offset = _mm_set1_epi16(k.y_offset);
+            const __m128i c128 = _mm_set1_epi16(128);
+            const __m128i ky = _mm_set1_epi16(k.y);
+            const __m128i kvr = _mm_set1_epi16(k.v_r);
+            const __m128i kug = _mm_set1_epi16(k.u_g);
+            const __m128i kvg = _mm_set1_epi16(k.v_g);
+            const __m128i kub = _mm_set1_epi16(k.u_b);
+            const __m128i round = _mm_set1_epi16(2);
+
+            int x = 0;
+            for (; x + 16 <= width; x += 16) {
+                const __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+                const __m128i u8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(u + x));
+                const __m128i v8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + x));
+
+                __m128i r16[2], g16[2], b16[2];
+                for (int half = 0; half < 2; ++half) {
+                    __m128i yy = half ? _mm_unpackhi_epi8(y8, zero) : _mm_unpacklo_epi8(y8, zero);
+                    __m128i uu = half ? _mm_unpackhi_epi8(u8, zero) : _mm_unpacklo_epi8(u8, zero);
+                    __m128i vv = half ? _mm_unpackhi_epi8(v8, zero) : _mm_unpacklo_epi8(v8, zero);
+                    yy = _mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(yy, y_offset), 7), ky);
+                    uu = _mm_slli_epi16(_mm_sub_epi16(uu, c128), 7);
+                    vv = _mm_slli_epi16(_mm_sub_epi16(vv, c128), 7);
+
+                    yy = _mm_add_epi16(yy, round);
+
+                    r16[half] = _mm_srai_epi16(_mm_add_epi16(yy, _mm_mulhi_epi16(vv, kvr)), 2);
+                    g16[half] = _mm_srai_epi16(
+                        _mm_add_epi16(yy, _mm_add_epi16(_mm_mulhi_epi16(uu, kug), _mm_mulhi_epi16(vv, kvg))), 2);
+                    b16[half] = _mm_srai_epi16(_mm_add_epi16(yy, _mm_mulhi_epi16(uu, kub)), 2);
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(r + x), _mm_packus_epi16(r16[0], r16[1]));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(g + x), _mm_packus_epi16(g16[0], g16[1]));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(b + x), _mm_packus_epi16(b16[0], b16[1]));
+            }
+            return x;
+        }
+
+        // 一次处理 16 个像素，色度水平方向最近邻上采样
+        int bgraRowSse2(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, const int width,
+                        const Coefficients &k) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xff));
+            const __m128i y_offset = _mm_set1_epi16(k.y_offset);
+            const __m128i c128 = _mm_set1_epi16(128);
+            const __m128i ky = _mm_set1_epi16(k.y);
+            const __m128i kvr = _mm_set1_epi16(k.v_r);
+            const __m128i kug = _mm_set1_epi16(k.u_g);
+            const __m128i kvg = _mm_set1_epi16(k.v_g);
+            const __m128i kub = _mm_set1_epi16(k.u_b);
+            const __m128i round = _mm_set1_epi16(2);
+
+            int x = 0;
+            for (; x + 16 <= width; x += 16) {
+                const __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+                __m128i u8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + (x >> 1)));
+                __m128i v8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + (x >> 1)));
+                u8 = _mm_unpacklo_epi8(u8, u8);
+                v8 = _mm_unpacklo_epi8(v8, v8);
+
+                __m128i r16[2], g16[2], b16[2];
+                for (int half = 0; half < 2; ++half) {
+                    __m128i yy = half ? _mm_unpackhi_epi8(y8, zero) : _mm_unpacklo_epi8(y8, zero);
+                    __m128i uu = half ? _mm_unpackhi_epi8(u8, zero) : _mm_unpacklo_epi8(u8, zero);
+                    __m128i vv = half ? _mm_unpackhi_epi8(v8, zero) : _mm_unpacklo_epi8(v8, zero);
+                    yy = _mm_mulhi_epi16(_mm_slli_epi16(_mm_sub_epi16(yy, y_offset), 7), ky);
+                    uu = _mm_slli_epi16(_mm_sub_epi16(uu, c128), 7);
+                    vv = _mm_slli_epi16(_mm_sub_epi16(vv, c128), 7);
+
+                    yy = _mm_add_epi16(yy, round);
+
+                    r16[half] = _mm_srai_epi16(_mm_add_epi16(yy, _mm_mulhi_epi16(vv, kvr)), 2);
+                    g16[half] = _mm_srai_epi16(
+                        _mm_add_epi16(yy, _mm_add_epi16(_mm_mulhi_epi16(uu, kug), _mm_mulhi_epi16(vv, kvg))), 2);
+                    b16[half] = _mm_srai_epi16(_mm_add_epi16(yy, _mm_mulhi_epi16(uu, kub)), 2);
+                }
+                const __m128i r = _mm_packus_epi16(r16[0], r16[1]);
+                const __m128i g = _mm_packus_epi16(g16[0], g16[1]);
+                const __m128i b = _mm_packus_epi16(b16[0], b16[1]);
+
+                const __m128i bg_lo = _mm_unpacklo_epi8(b, g);
+                const __m128i bg_hi = _mm_unpackhi_epi8(b, g);
+                const __m128i ra_lo = _mm_unpacklo_epi8(r, alpha);
+                const __m128i ra_hi = _mm_unpackhi_epi8(r, alpha);
+                auto *out = reinterpret_cast<__m128i *>(dst + 4 * x);
+                _mm_storeu_si128(out, _mm_unpacklo_epi16(bg_lo, ra_lo));
+                _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(bg_lo, ra_lo));
+                _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(bg_hi, ra_hi));
+                _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(bg_hi, ra_hi));
+            }
+            return x;
+        }
+
+        int interleaveRowSse2(const uint8_t *u, const uint8_t *v, uint8_t *dst, const int chroma_width) {
+            int x = 0;
+            for (; x + 16 <= chroma_width; x += 16) {
+                const __m128i u8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(u + x));
+                const __m128i v8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + x));
+                auto *out = reinterpret_cast<__m128i *>(dst + 2 * x);
+                _mm_storeu_si128(out, _mm_unpacklo_epi8(u8, v8));
+                _mm_storeu_si128(out + 1, _mm_unpackhi_epi8(u8, v8));
+            }
+            return x;
+        }
+#endif
+    }
+
+    const Coefficients &coefficients(const bool bt709, const bool full_range) {
+        if (full_range) return bt709 ? kBt709Full : kBt601Full;
+        return bt709 ? kBt709Limited : kBt601Limited;
+    }
+
+    bool isBt709(const AVFrame *frame) {
+        return frame->colorspace == AVCOL_SPC_BT709;
+    }
+
+    bool isFullRange(const AVFrame *frame) {
+        return frame->color_range == AVCOL_RANGE_JPEG || frame->format == AV_PIX_FMT_YUVJ420P;
+    }
+
+    bool hasLumaPlane(const AVFrame *frame) {
+        switch (frame->format) {
+            case AV_PIX_FMT_YUV420P:
+            case AV_PIX_FMT_YUVJ420P:
+            case AV_PIX_FMT_NV12:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    void i420ToBgra(const uint8_t *const src[3], const int src_stride[3], uint8_t *dst, const int dst_stride,
+                    const int width, const int height, const Coefficients &k) {
+        for (int row = 0; row < height; ++row) {
+            const uint8_t *y = src[0] + static_cast<ptrdiff_t>(row) * src_stride[0];
+            const uint8_t *u = src[1] + static_cast<ptrdiff_t>(row >> 1) * src_stride[1];
+            const uint8_t *v = src[2] + static_cast<ptrdiff_t>(row >> 1) * src_stride[2];
+            uint8_t *out = dst + static_cast<ptrdiff_t>(row) * dst_stride;
+
+            int x = 0;
+#ifdef AIRPLAY_YUV_SSE2
+            x = bgraRowSse2(y, u, v, out, width, k);
+#endif
+            bgraRowScalar(y, u, v, out, x, width, k);
+        }
+    }
+
+    void yuvToPlanarRgb(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *r, uint8_t *g, uint8_t *b,
+                        const int width, const Coefficients &k) {
+        int x = 0;
+#ifdef AIRPLAY_YUV_SSE2
+        x = planarRowSse2(y, u, v, r, g, b, width, k);
+#endif
+        planarRowScalar(y, u, v, r, g, b, x, width, k);
+    }
+
+    void i420ToNv12(const uint8_t *const src[3], const int src_stride[3], uint8_t *dst_y, const int dst_y_stride,
+                    uint8_t *dst_uv, const int dst_uv_stride, const int width, const int height) {
+        for (int row = 0; row < height; ++row) {
+            memcpy(dst_y + static_cast<ptrdiff_t>(row) * dst_y_stride,
+                   src[0] + static_cast<ptrdiff_t>(row) * src_stride[0], width);
+        }
+
+        const int chroma_width = (width + 1) >> 1;
+        const int chroma_height = (height + 1) >> 1;
+        for (int row = 0; row < chroma_height; ++row) {
+            const uint8_t *u = src[1] + static_cast<ptrdiff_t>(row) * src_stride[1];
+            const uint8_t *v = src[2] + static_cast<ptrdiff_t>(row) * src_stride[2];
+            uint8_t *out = dst_uv + static_cast<ptrdiff_t>(row) * dst_uv_stride;
+
+            int x = 0;
+#ifdef AIRPLAY_YUV_SSE2
+            x = interleaveRowSse2(u, v, out, chroma_width);
+#endif
+            for (; x < chroma_width; ++x) {
+                out[2 * x] = u[x];
+                out[2 * x + 1] = v[x];
+            }
+        }
+    }
+} // namespace airplay_streamer::yuv
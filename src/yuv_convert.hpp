@@ -0,0 +1,42 @@
+// src/yuv_convert.hpp
+#pragma once
+
+#include <cstdint>
+
+struct AVFrame;
+
+namespace ender::airplay_streamer::yuv {
+    // YUV -> RGB 定点系数：输入左移 7 位后与系数做 16 位乘取高位，即 value * coeff / 512，
+    // 系数为 Q11，结果以 1/4 为单位，最后四舍五入
+    struct Coefficients {
+        int16_t y_offset;
+        int16_t y;
+        int16_t v_r;
+        int16_t u_g;
+        int16_t v_g;
+        int16_t u_b;
+    };
+
+    // bt709 为 false 时按 BT.601；full_range 对应 YUVJ / AVCOL_RANGE_JPEG
+    const Coefficients &coefficients(bool bt709, bool full_range);
+
+    // 帧的色彩参数：没标注的按 BT.601 / 有限范围，与 H.264 的默认值一致
+    bool isBt709(const AVFrame *frame);
+
+    bool isFullRange(const AVFrame *frame);
+
+    // 第一个平面是 8 位全分辨率亮度的格式（yuv420p、yuvj420p、nv12）
+    bool hasLumaPlane(const AVFrame *frame);
+
+    // 一帧 yuv420p 转 BGRA，dst 每像素 4 字节
+    void i420ToBgra(const uint8_t *const src[3], const int src_stride[3], uint8_t *dst, int dst_stride,
+                    int width, int height, const Coefficients &k);
+
+    // 一行逐像素对齐的 Y/U/V（色度已上采样到全分辨率）转成 R/G/B 三个平面
+    void yuvToPlanarRgb(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *r, uint8_t *g, uint8_t *b,
+                        int width, const Coefficients &k);
+
+    // 一帧 yuv420p 转 NV12
+    void i420ToNv12(const uint8_t *const src[3], const int src_stride[3], uint8_t *dst_y, int dst_y_stride,
+                    uint8_t *dst_uv, int dst_uv_stride, int width, int height);
+} // namespace airplay_streamer::yuv
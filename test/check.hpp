@@ -0,0 +1,14 @@
+// test/check.hpp
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// 单元测试用的断言，失败时打印位置并以非零状态退出，由 ctest 判定
+#define CHECK(cond)                                                                   \
+    do {                                                                              \
+        if (!(cond)) {                                                                \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1);                                                             \
+        }                                                                             \
+    } while (0)
@@ -0,0 +1,314 @@
+// test/decoder_backend_bench.cpp
+// 同一段 H.264 流分别经 DecoderBackend 接口（AvcodecBackend）和直接调用 libavcodec 解码，
+// 比较每帧耗时，并确认两条路径输出的帧数和像素一致。
+// 测试流用 FFmpeg 里的 H.264 编码器现场生成，没有编码器时跳过（返回 77）
+#include "check.hpp"
+
+#include "avcodec_backend.hpp"
+#include "decoder_pool.hpp"
+#include "decoder_settings.hpp"
+#include "frame_pool.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+}
+
+using namespace ender::airplay_streamer;
+
+namespace {
+    constexpr int kSkipped = 77;
+    constexpr int kWidth = 1280;
+    constexpr int kHeight = 720;
+    constexpr int kFrames = 120;
+    constexpr int kRounds = 5;
+
+    struct Stream {
+        std::vector<uint8_t> avcc;
+        std::vector<std::vector<uint8_t>> units; // AVCC 格式，和 AirPlay 镜像流一样
+    };
+
+    // 按起始码切分 Annex-B，返回每个 NAL（不含起始码）
+    std::vector<std::pair<const uint8_t *, size_t>> splitAnnexB(const uint8_t *data, const size_t size) {
+        std::vector<std::pair<const uint8_t *, size_t>> nals;
+        size_t start = 0;
+        bool in_nal = false;
+        for (size_t i = 0; i + 3 <= size;) {
+            if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+                if (in_nal) {
+                    size_t end = i;
+                    while (end > start && data[end - 1] == 0) --end;
+                    nals.emplace_back(data + start, end - start);
+                }
+                i += 3;
+                start = i;
+                in_nal = true;
+            } else {
+                ++i;
+            }
+        }
+        if (in_nal && start < size) nals.emplace_back(data + start, size - start);
+        return nals;
+    }
+
+    void appendAvcc(std::vector<uint8_t> &out, const uint8_t *nal, const size_t size) {
+        out.push_back(static_cast<uint8_t>(size >> 24));
+        out.push_back(static_cast<uint8_t>(size >> 16));
+        out.push_back(static_cast<uint8_t>(size >> 8));
+        out.push_back(static_cast<uint8_t>(size));
+        out.insert(out.end(), nal, nal + size);
+    }
+
+    // Annex-B 的 SPS/PPS 组成 avcC 记录（4 字节长度前缀）
+    std::vector<uint8_t> makeAvcC(const std::vector<std::pair<const uint8_t *, size_t>> &nals) {
+        std::vector<std::pair<const uint8_t *, size_t>> sps, pps;
+        for (const auto &nal: nals) {
+            if ((nal.first[0] & 0x1f) == 7) sps.push_back(nal);
+            if ((nal.first[0] & 0x1f) == 8) pps.push_back(nal);
+        }
+        if (sps.empty() || pps.empty() || sps[0].second < 4) return {};
+
+        std::vector<uint8_t> avcc = {1, sps[0].first[1], sps[0].first[2], sps[0].first[3], 0xff};
+        avcc.push_back(static_cast<uint8_t>(0xe0 | sps.size()));
+        for (const auto &[nal, size]: sps) {
+            avcc.push_back(static_cast<uint8_t>(size >> 8));
+            avcc.push_back(static_cast<uint8_t>(size));
+            avcc.insert(avcc.end(), nal, nal + size);
+        }
+        avcc.push_back(static_cast<uint8_t>(pps.size()));
+        for (const auto &[nal, size]: pps) {
+            avcc.push_back(static_cast<uint8_t>(size >> 8));
+            avcc.push_back(static_cast<uint8_t>(size));
+            avcc.insert(avcc.end(), nal, nal + size);
+        }
+        return avcc;
+    }
+
+    // 编码一段有运动的合成画面；没有可用的编码器时返回 false
+    bool encodeStream(Stream &stream) {
+        const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+        if (!codec) return false;
+
+        AVCodecContext *ctx = avcodec_alloc_context3(codec);
+        CHECK(ctx != nullptr);
+        ctx->width = kWidth;
+        ctx->height = kHeight;
+        ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+        ctx->time_base = AVRational{1, 60};
+        ctx->gop_size = 60;
+        ctx->max_b_frames = 0; // 和 AirPlay 一样没有 B 帧
+        ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        if (avcodec_open2(ctx, codec, nullptr) < 0) {
+            avcodec_free_context(&ctx);
+            return false;
+        }
+
+        AVFrame *frame = av_frame_alloc();
+        AVPacket *packet = av_packet_alloc();
+        CHECK(frame && packet);
+        frame->width = kWidth;
+        frame->height = kHeight;
+        frame->format = AV_PIX_FMT_YUV420P;
+        CHECK(av_frame_get_buffer(frame, 0) >= 0);
+
+        std::vector<std::pair<const uint8_t *, size_t>> header_nals;
+        if (ctx->extradata_size > 0 && ctx->extradata[0] == 1) {
+            stream.avcc.assign(ctx->extradata, ctx->extradata + ctx->extradata_size);
+        } else {
+            stream.avcc = makeAvcC(splitAnnexB(ctx->extradata, ctx->extradata_size));
+        }
+        const bool annexb = !(ctx->extradata_size > 0 && ctx->extradata[0] == 1);
+
+        auto drain = [&] {
+            while (avcodec_receive_packet(ctx, packet) >= 0) {
+                std::vector<uint8_t> unit;
+                if (annexb) {
+                    for (const auto &[nal, size]: splitAnnexB(packet->data, packet->size)) {
+                        // 参数集只放在 avcC 里，和镜像流一致
+                        const int type = nal[0] & 0x1f;
+                        if (type == 7 || type == 8) {
+                            if (stream.avcc.empty()) header_nals.emplace_back(nal, size);
+                            continue;
+                        }
+                        appendAvcc(unit, nal, size);
+                    }
+                    if (stream.avcc.empty()) stream.avcc = makeAvcC(header_nals);
+                    header_nals.clear(); // 指向 packet 的数据，unref 之后失效
+                } else {
+                    unit.assign(packet->data, packet->data + packet->size);
+                }
+                if (!unit.empty()) stream.units.push_back(std::move(unit));
+                av_packet_unref(packet);
+            }
+        };
+
+        for (int i = 0; i < kFrames; ++i) {
+            CHECK(av_frame_make_writable(frame) >= 0);
+            for (int y = 0; y < kHeight; ++y) {
+                for (int x = 0; x < kWidth; ++x) {
+                    frame->data[0][y * frame->linesize[0] + x] = static_cast<uint8_t>(x + y + 3 * i);
+                }
+            }
+            for (int y = 0; y < kHeight / 2; ++y) {
+                memset(frame->data[1] + y * frame->linesize[1], 128 + (y + i) % 32, kWidth / 2);
+                memset(frame->data[2] + y * frame->linesize[2], 128 - (y + 2 * i) % 32, kWidth / 2);
+            }
+            frame->pts = i;
+            CHECK(avcodec_send_frame(ctx, frame) >= 0);
+            drain();
+        }
+        CHECK(avcodec_send_frame(ctx, nullptr) >= 0);
+        drain();
+
+        av_packet_free(&packet);
+        av_frame_free(&frame);
+        avcodec_free_context(&ctx);
+        return !stream.avcc.empty() && !stream.units.empty();
+    }
+
+    // 带 padding 的包缓冲，和 PacketPool 给出的一样
+    AVBufferRef *packetBuffer(const std::vector<uint8_t> &unit) {
+        AVBufferRef *buffer = av_buffer_alloc(unit.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+        CHECK(buffer != nullptr);
+        memcpy(buffer->data, unit.data(), unit.size());
+        memset(buffer->data + unit.size(), 0, AV_INPUT_BUFFER_PADDING_SIZE);
+        return buffer;
+    }
+
+    struct Result {
+        int frames = 0;
+        uint64_t checksum = 0;
+        double us_per_frame = 0;
+    };
+
+    void accumulate(Result &result, const AVFrame *frame) {
+        ++result.frames;
+        uint64_t hash = result.checksum;
+        for (int y = 0; y < frame->height; y += 7) {
+            const uint8_t *row = frame->data[0] + y * frame->linesize[0];
+            for (int x = 0; x < frame->width; x += 5) hash = hash * 1099511628211ull ^ row[x];
+        }
+        result.checksum = hash;
+    }
+
+    class BenchOutput final : public DecoderOutput {
+    public:
+        explicit BenchOutput(Result &result) : result_(result), pool_(FramePool::create()) {
+        }
+
+        int allocate(AVFrame *frame) override { return pool_->allocate(frame); }
+
+        void attach(AVCodecContext *ctx) override { pool_->attach(ctx); }
+
+        void reserve(AVCodecContext *ctx, const int width, const int height, const int count) override {
+            pool_->reserve(ctx, width, height, count);
+        }
+
+        void emit(AVFrame *frame) override {
+            accumulate(result_, frame);
+            av_frame_unref(frame);
+        }
+
+    private:
+        Result &result_;
+        std::shared_ptr<FramePool> pool_;
+    };
+
+    DecoderParams makeParams(const DecoderSettings &settings, const Config &config, const Stream &stream) {
+        DecoderParams params = decoderParams(settings, config);
+        params.avcc = stream.avcc.data();
+        params.avcc_size = stream.avcc.size();
+        params.width = kWidth;
+        params.height = kHeight;
+        return params;
+    }
+
+    // 会话里的路径：AvcodecBackend 经虚接口解码，帧缓冲来自帧池
+    Result runBackend(const Stream &stream, const DecoderSettings &settings, const Config &config) {
+        Result result;
+        DecoderPool pool;
+        BenchOutput output(result);
+        double total_us = 0;
+        for (int round = 0; round < kRounds; ++round) {
+            result = Result{};
+            std::unique_ptr<DecoderBackend> backend = std::make_unique<AvcodecBackend>(pool);
+            backend->open(makeParams(settings, config, stream), output);
+            const auto start = std::chrono::steady_clock::now();
+            int64_t pts = 0;
+            for (const auto &unit: stream.units) {
+                CHECK(backend->decode(packetBuffer(unit), static_cast<int>(unit.size()), pts++) >= 0);
+            }
+            total_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        }
+        result.us_per_frame = total_us / (kRounds * static_cast<double>(stream.units.size()));
+        return result;
+    }
+
+    // 接口之前的做法：同样的设置和帧池，直接 send_packet / receive_frame
+    Result runDirect(const Stream &stream, const DecoderSettings &settings) {
+        Result result;
+        const std::shared_ptr<FramePool> frame_pool = FramePool::create();
+        AVPacket *packet = av_packet_alloc();
+        AVFrame *frame = av_frame_alloc();
+        CHECK(packet && frame);
+        double total_us = 0;
+        for (int round = 0; round < kRounds; ++round) {
+            result = Result{};
+            AVCodecContext *ctx = openDecoder(settings, frame_pool.get(), stream.avcc.data(), stream.avcc.size());
+            frame_pool->reserve(ctx, kWidth, kHeight, settings.thread_count + 6);
+            const auto start = std::chrono::steady_clock::now();
+            int64_t pts = 0;
+            for (const auto &unit: stream.units) {
+                packet->buf = packetBuffer(unit);
+                packet->data = packet->buf->data;
+                packet->size = static_cast<int>(unit.size());
+                packet->pts = pts++;
+                CHECK(avcodec_send_packet(ctx, packet) >= 0);
+                av_packet_unref(packet);
+                while (avcodec_receive_frame(ctx, frame) >= 0) {
+                    accumulate(result, frame);
+                    av_frame_unref(frame);
+                }
+            }
+            total_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            avcodec_free_context(&ctx);
+        }
+        result.us_per_frame = total_us / (kRounds * static_cast<double>(stream.units.size()));
+        av_frame_free(&frame);
+        av_packet_free(&packet);
+        return result;
+    }
+}
+
+int main() {
+    Stream stream;
+    if (!encodeStream(stream)) {
+        std::puts("decoder_backend_bench skipped: no usable H.264 encoder");
+        return kSkipped;
+    }
+
+    // 低延迟设置下解码器不缓存帧，两条路径在送完最后一个包时都已输出全部帧
+    for (const bool low_latency: {true, false}) {
+        Config config;
+        config.low_latency = low_latency;
+        const DecoderSettings settings = chooseDecoderSettings(config, kWidth, kHeight, 1);
+
+        const Result direct = runDirect(stream, settings);
+        const Result backend = runBackend(stream, settings, config);
+        std::printf("%s, %d thread(s), %zu access units\n", low_latency ? "low latency" : "default",
+                    settings.thread_count, stream.units.size());
+        std::printf("  direct libavcodec     %8.1f us/frame, %d frames\n", direct.us_per_frame, direct.frames);
+        std::printf("  DecoderBackend        %8.1f us/frame, %d frames\n", backend.us_per_frame, backend.frames);
+
+        CHECK(direct.frames > 0);
+        CHECK(backend.frames == direct.frames);
+        CHECK(backend.checksum == direct.checksum);
+    }
+    std::puts("decoder_backend_bench passed");
+    return 0;
+}
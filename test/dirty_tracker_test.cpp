@@ -0,0 +1,50 @@
+// test/dirty_tracker_test.cpp
+// DirtyTracker 的阈值是严格大于：差值等于 threshold 不算变化，覆盖 SSE2 主体和标量尾部的每一列
+#include "check.hpp"
+#include "test_frame.hpp"
+
+#include "dirty_tracker.hpp"
+
+#include <cstdio>
+#include <memory>
+
+using namespace ender::airplay_streamer;
+
+namespace {
+    void testThresholdPerColumn() {
+        DirtyTracking policy;
+        policy.enabled = true;
+        policy.tile_size = 16;
+        policy.threshold = 3;
+        for (const int width: test::kOddWidths) {
+            test::TestFrame a(width, 16);
+            test::TestFrame b(width, 16);
+            b.planes[0] = a.planes[0];
+            b.frame.data[0] = b.planes[0].data();
+            DirtyTracker tracker(policy);
+            const std::shared_ptr<AVFrame> reference(&a.frame, [](AVFrame *) {});
+            tracker.accept(reference);
+
+            // 每列单独改一个像素
+            for (int x = 0; x < width; ++x) {
+                for (const int delta: {3, 4}) {
+                    uint8_t &pixel = b.planes[0][5 * b.stride[0] + x];
+                    const uint8_t original = pixel;
+                    pixel = static_cast<uint8_t>(original >= 128 ? original - delta : original + delta);
+                    TileMap map;
+                    const bool changed = tracker.compare(&b.frame, map);
+                    CHECK(changed == (delta > policy.threshold));
+                    CHECK(map.dirty_tiles == (changed ? 1 : 0));
+                    if (changed) CHECK(map.dirty[x / policy.tile_size] == 1);
+                    pixel = original;
+                }
+            }
+        }
+    }
+}
+
+int main() {
+    testThresholdPerColumn();
+    std::puts("dirty_tracker_test passed");
+    return 0;
+}
@@ -0,0 +1,77 @@
+// test/frame_fanout_test.cpp
+// 会话是否解码由 FrameFanout::wants 决定，订阅者变化后会话靠 version 发现
+#include "check.hpp"
+
+#include "frame_fanout.hpp"
+
+#include <cstdio>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+using namespace ender::airplay_streamer;
+
+namespace {
+    std::shared_ptr<AVFrame> makeFrame() {
+        return {av_frame_alloc(), [](AVFrame *f) { av_frame_free(&f); }};
+    }
+
+    std::shared_ptr<FrameStream> makeStream(const uint64_t session_id) {
+        FrameStreamOptions options;
+        options.session_id = session_id;
+        return std::make_shared<FrameStream>(options);
+    }
+
+    void testWantsFollowsSubscribers() {
+        FrameFanout fanout;
+        CHECK(fanout.empty());
+        CHECK(!fanout.wants(1));
+
+        uint64_t version = fanout.version();
+        const auto bound = makeStream(2);
+        const SubscriptionId bound_id = fanout.subscribe(bound);
+        CHECK(fanout.version() != version);
+        CHECK(!fanout.empty());
+        // 绑定会话 2 的流不让会话 1 解码
+        CHECK(!fanout.wants(1));
+        CHECK(fanout.wants(2));
+
+        version = fanout.version();
+        const auto queue = std::make_shared<FrameQueue>(2, DropPolicy::DropOldest);
+        const SubscriptionId queue_id = fanout.subscribe(queue, "all");
+        CHECK(fanout.version() != version);
+        CHECK(fanout.wants(1));
+        CHECK(fanout.wants(2));
+
+        fanout.publish(makeFrame(), 10, 1);
+        fanout.publish(makeFrame(), 20, 2);
+        CHECK(queue->size() == 2);
+        CHECK(bound->size() == 1);
+
+        version = fanout.version();
+        fanout.unsubscribe(queue_id);
+        CHECK(fanout.version() != version);
+        CHECK(queue->closed());
+        CHECK(!fanout.wants(1));
+        CHECK(fanout.wants(2));
+
+        // 会话结束时关闭绑定它的流，但订阅还在，直到调用方取消
+        fanout.endSession(2);
+        CHECK(bound->closed());
+        fanout.unsubscribe(bound_id);
+        CHECK(fanout.empty());
+        CHECK(!fanout.wants(2));
+
+        // 未知 id 不改变版本
+        version = fanout.version();
+        fanout.unsubscribe(12345);
+        CHECK(fanout.version() == version);
+    }
+}
+
+int main() {
+    testWantsFollowsSubscribers();
+    std::puts("frame_fanout_test passed");
+    return 0;
+}
@@ -0,0 +1,62 @@
+// test/frame_ladder_test.cpp
+// FrameLadder 的 1/2 级与逐像素 (a + b + c + d + 2) >> 2 一致，覆盖 SSE2 主体、标量尾部和奇数尺寸
+#include "check.hpp"
+#include "test_frame.hpp"
+
+#include "frame_ladder.hpp"
+#include "frame_pool.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace ender::airplay_streamer;
+
+namespace {
+    void testHalfLevel() {
+        FrameLadder ladder(FramePool::create(), {2});
+        for (const int width: test::kOddWidths) {
+            for (const int height: {1, 2, 5}) {
+                test::TestFrame src(width, height);
+                AVFrame *raw = av_frame_alloc();
+                CHECK(raw);
+                *raw = src.frame;
+                const std::shared_ptr<AVFrame> frame(raw, [](AVFrame *f) {
+                    *f = AVFrame{}; // 像素属于 TestFrame
+                    av_frame_free(&f);
+                });
+                std::vector<std::shared_ptr<AVFrame>> out;
+                CHECK(ladder.build(frame, out));
+                CHECK(out.size() == 1);
+                const AVFrame *half = out[0].get();
+                for (int p = 0; p < 3; ++p) {
+                    const int shift = p == 0 ? 0 : 1;
+                    const int src_width = (width + shift) >> shift;
+                    const int src_height = (height + shift) >> shift;
+                    const int dst_width = (src_width + 1) >> 1;
+                    const int dst_height = (src_height + 1) >> 1;
+                    const uint8_t *s = src.frame.data[p];
+                    const int ss = src.frame.linesize[p];
+                    for (int y = 0; y < dst_height; ++y) {
+                        const int r0 = 2 * y;
+                        const int r1 = std::min(r0 + 1, src_height - 1);
+                        for (int x = 0; x < dst_width; ++x) {
+                            const int x0 = 2 * x;
+                            const int x1 = std::min(x0 + 1, src_width - 1);
+                            const int expected = (s[r0 * ss + x0] + s[r0 * ss + x1] + s[r1 * ss + x0] +
+                                                  s[r1 * ss + x1] + 2) >> 2;
+                            CHECK(half->data[p][y * half->linesize[p] + x] == expected);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main() {
+    testHalfLevel();
+    std::puts("frame_ladder_test passed");
+    return 0;
+}
@@ -0,0 +1,140 @@
+// test/h264_utils_test.cpp
+#include "check.hpp"
+
+#include "h264_utils.hpp"
+
+#include <cstdio>
+#include <vector>
+
+using namespace ender::airplay_streamer;
+
+namespace {
+    void appendNal(std::vector<uint8_t> &out, const std::vector<uint8_t> &nal) {
+        const auto size = static_cast<uint32_t>(nal.size());
+        out.push_back(static_cast<uint8_t>(size >> 24));
+        out.push_back(static_cast<uint8_t>(size >> 16));
+        out.push_back(static_cast<uint8_t>(size >> 8));
+        out.push_back(static_cast<uint8_t>(size));
+        out.insert(out.end(), nal.begin(), nal.end());
+    }
+
+    size_t countNals(const std::vector<uint8_t> &data, bool &valid) {
+        size_t count = 0;
+        valid = h264::forEachAvccNal(data.data(), data.size(), [&count](const uint8_t *, size_t) { ++count; });
+        return count;
+    }
+
+    void testForEachAvccNal() {
+        std::vector<uint8_t> frame;
+        appendNal(frame, {0x65, 1, 2, 3});
+        appendNal(frame, {0x01, 4});
+        bool valid = false;
+        CHECK(countNals(frame, valid) == 2);
+        CHECK(valid);
+        CHECK(h264::isKeyframeAvcc(frame.data(), frame.size()));
+
+        // 空输入合法，但不含任何 NAL
+        CHECK(h264::forEachAvccNal(frame.data(), 0, [](const uint8_t *, size_t) { CHECK(false); }));
+
+        // 长度前缀不完整
+        for (const size_t cut: {1, 2, 3}) {
+            std::vector<uint8_t> truncated(frame.begin(), frame.begin() + cut);
+            CHECK(countNals(truncated, valid) == 0);
+            CHECK(!valid);
+        }
+
+        // 最后一个 NAL 被截断：前一个 NAL 仍然被访问到
+        std::vector<uint8_t> short_tail(frame.begin(), frame.end() - 1);
+        CHECK(countNals(short_tail, valid) == 1);
+        CHECK(!valid);
+
+        // 长度为 0
+        std::vector<uint8_t> zero;
+        appendNal(zero, {});
+        CHECK(countNals(zero, valid) == 0);
+        CHECK(!valid);
+
+        // 长度接近 size_t 上限时不能因加法回绕而越界
+        const std::vector<uint8_t> huge = {0xff, 0xff, 0xff, 0xff, 0x65};
+        CHECK(countNals(huge, valid) == 0);
+        CHECK(!valid);
+
+        // 格式有误时按参考帧处理，不会被整帧丢掉
+        CHECK(h264::isReferenceAvcc(huge.data(), huge.size()));
+        std::vector<uint8_t> disposable;
+        appendNal(disposable, {0x01, 0});
+        CHECK(!h264::isReferenceAvcc(disposable.data(), disposable.size()));
+    }
+
+    void testAnnexBRoundTrip() {
+        std::vector<uint8_t> frame;
+        appendNal(frame, {0x67, 1, 2});
+        appendNal(frame, {0x68, 3});
+        appendNal(frame, {0x65, 4, 5, 6, 7});
+        const std::vector<uint8_t> original = frame;
+
+        std::vector<uint32_t> nal_sizes;
+        CHECK(h264::avccToAnnexB(frame.data(), frame.size(), &nal_sizes));
+        CHECK((nal_sizes == std::vector<uint32_t>{3, 2, 5}));
+        CHECK(frame[0] == 0 && frame[1] == 0 && frame[2] == 0 && frame[3] == 1);
+        h264::annexBToAvcc(frame.data(), nal_sizes);
+        CHECK(frame == original);
+
+        std::vector<uint8_t> broken(original.begin(), original.end() - 2);
+        CHECK(!h264::avccToAnnexB(broken.data(), broken.size(), &nal_sizes));
+    }
+
+    std::vector<uint8_t> makeAvcC() {
+        return {
+            1, 0x64, 0x00, 0x28, 0xff, // version, profile, compatibility, level, length size 4
+            0xe1, 0x00, 0x04, 0x67, 0x64, 0x00, 0x28, // 1 个 SPS
+            0x01, 0x00, 0x03, 0x68, 0xee, 0x3c, // 1 个 PPS
+        };
+    }
+
+    void testParseAvcC() {
+        const std::vector<uint8_t> record = makeAvcC();
+        h264::AvcConfig config;
+        CHECK(h264::parseAvcC(record.data(), record.size(), config));
+        CHECK(config.avcc == record);
+        CHECK(config.nal_length_size == 4);
+        CHECK(config.profile == 0x64);
+        CHECK(config.level == 0x28);
+        const std::vector<uint8_t> annexb = {0, 0, 0, 1, 0x67, 0x64, 0x00, 0x28, 0, 0, 0, 1, 0x68, 0xee, 0x3c};
+        CHECK(config.annexb == annexb);
+
+        // 每一种截断长度都必须被拒绝，且不修改输出
+        for (size_t size = 0; size < record.size(); ++size) {
+            h264::AvcConfig untouched;
+            CHECK(!h264::parseAvcC(record.data(), size, untouched));
+            CHECK(untouched.avcc.empty());
+        }
+
+        std::vector<uint8_t> bad_version = record;
+        bad_version[0] = 0;
+        CHECK(!h264::parseAvcC(bad_version.data(), bad_version.size(), config));
+
+        // SPS 长度超出记录
+        std::vector<uint8_t> long_sps = record;
+        long_sps[7] = 0x40;
+        CHECK(!h264::parseAvcC(long_sps.data(), long_sps.size(), config));
+
+        // PPS 长度为 0
+        std::vector<uint8_t> empty_pps = record;
+        empty_pps[14] = 0;
+        CHECK(!h264::parseAvcC(empty_pps.data(), empty_pps.size(), config));
+
+        // 声明了 2 个 PPS 但只有 1 个
+        std::vector<uint8_t> missing_pps = record;
+        missing_pps[12] = 2;
+        CHECK(!h264::parseAvcC(missing_pps.data(), missing_pps.size(), config));
+    }
+}
+
+int main() {
+    testForEachAvccNal();
+    testAnnexBRoundTrip();
+    testParseAvcC();
+    std::puts("h264_utils_test passed");
+    return 0;
+}
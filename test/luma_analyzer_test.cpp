@@ -0,0 +1,48 @@
+// test/luma_analyzer_test.cpp
+// LumaAnalyzer 的 SSE2 累加与直接按定义计算的均值/方差一致，宽度覆盖向量主体和标量尾部
+#include "check.hpp"
+#include "test_frame.hpp"
+
+#include "luma_analyzer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace ender::airplay_streamer;
+
+namespace {
+    void testFullSampling() {
+        Analytics policy;
+        policy.enabled = true;
+        policy.row_step = 1;
+        policy.column_step = 1;
+        for (const int width: {1, 15, 17, 63, 641, 4099, 4111}) {
+            test::TestFrame src(width, 3);
+            LumaAnalyzer analyzer(policy);
+            FrameAnalytics out;
+            CHECK(analyzer.analyze(&src.frame, out));
+
+            double sum = 0;
+            double squares = 0;
+            for (int y = 0; y < 3; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    const double v = src.planes[0][y * src.stride[0] + x];
+                    sum += v;
+                    squares += v * v;
+                }
+            }
+            const double pixels = 3.0 * width;
+            const double mean = sum / pixels;
+            CHECK(std::fabs(out.mean - mean) < 1e-3);
+            CHECK(std::fabs(out.variance - std::max(0.0, squares / pixels - mean * mean)) < 1e-2);
+            CHECK(out.samples == static_cast<uint32_t>(pixels));
+        }
+    }
+}
+
+int main() {
+    testFullSampling();
+    std::puts("luma_analyzer_test passed");
+    return 0;
+}
@@ -0,0 +1,151 @@
+// test/queue_test.cpp
+#include "check.hpp"
+
+#include <frame_queue.hpp>
+#include "mpmc_queue.hpp"
+#include "spsc_queue.hpp"
+
+#include <cstdio>
+#include <thread>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+using namespace ender::airplay_streamer;
+
+namespace {
+    std::shared_ptr<AVFrame> makeFrame() {
+        return {av_frame_alloc(), [](AVFrame *f) { av_frame_free(&f); }};
+    }
+
+    // 单线程填满、拒绝、按序取出，多轮以覆盖下标回绕
+    template<typename Queue>
+    void testOverflow() {
+        for (const size_t capacity: {3, 4, 7}) {
+            Queue queue(capacity);
+            CHECK(queue.capacity() == capacity);
+            int next_push = 0;
+            int next_pop = 0;
+            for (int round = 0; round < 5; ++round) {
+                while (queue.size() < capacity) {
+                    int value = next_push++;
+                    CHECK(queue.tryPush(value));
+                }
+                int rejected = -1;
+                CHECK(!queue.tryPush(rejected));
+                CHECK(rejected == -1);
+                // 每轮只取出一部分，让头尾落在不同的槽位上
+                for (size_t i = 0; i < capacity / 2 + 1; ++i) {
+                    int out = -1;
+                    CHECK(queue.tryPop(out));
+                    CHECK(out == next_pop++);
+                }
+            }
+            int out = -1;
+            while (queue.tryPop(out)) CHECK(out == next_pop++);
+            CHECK(next_pop == next_push);
+            CHECK(queue.size() == 0);
+        }
+    }
+
+    // 一个生产者线程、一个消费者线程，容量很小以频繁触发满和空
+    template<typename Queue>
+    void testTwoThreadStress() {
+        constexpr int kItems = 200000;
+        for (const size_t capacity: {1, 2, 64}) {
+            Queue queue(capacity);
+            std::thread producer([&queue] {
+                for (int i = 0; i < kItems; ++i) {
+                    int value = i;
+                    while (!queue.tryPush(value)) std::this_thread::yield();
+                }
+            });
+            int expected = 0;
+            while (expected < kItems) {
+                int out = -1;
+                if (!queue.tryPop(out)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                CHECK(out == expected);
+                ++expected;
+            }
+            producer.join();
+            int out = -1;
+            CHECK(!queue.tryPop(out));
+        }
+    }
+
+    void testMpmcSmallCapacity() {
+        for (const size_t capacity: {1, 2}) {
+            MpmcQueue<int> queue(capacity);
+            for (int round = 0; round < 3; ++round) {
+                for (size_t i = 0; i < capacity; ++i) {
+                    int value = static_cast<int>(round * 10 + i);
+                    CHECK(queue.tryPush(value));
+                }
+                int rejected = -1;
+                CHECK(!queue.tryPush(rejected));
+                CHECK(rejected == -1);
+                CHECK(queue.size() == capacity);
+                for (size_t i = 0; i < capacity; ++i) {
+                    int out = -1;
+                    CHECK(queue.tryPop(out));
+                    CHECK(out == static_cast<int>(round * 10 + i));
+                }
+                int out = -1;
+                CHECK(!queue.tryPop(out));
+            }
+        }
+    }
+
+    void testFrameQueueOverflow() {
+        for (const size_t capacity: {1, 2}) {
+            for (const DropPolicy policy: {DropPolicy::DropOldest, DropPolicy::DropNewest}) {
+                FrameQueue queue(capacity, policy);
+                CHECK(queue.capacity() == capacity);
+                constexpr int kPushed = 5;
+                for (int pts = 0; pts < kPushed; ++pts) {
+                    const bool accepted = queue.push(makeFrame(), pts);
+                    CHECK(accepted == (policy == DropPolicy::DropOldest || pts < static_cast<int>(capacity)));
+                }
+                CHECK(queue.size() == capacity);
+                CHECK(queue.framesDropped() == kPushed - capacity);
+
+                // DropOldest 留下最新的几帧，DropNewest 留下最早的几帧
+                const int first = policy == DropPolicy::DropOldest ? kPushed - static_cast<int>(capacity) : 0;
+                for (size_t i = 0; i < capacity; ++i) {
+                    QueuedFrame item;
+                    CHECK(queue.tryPop(item));
+                    CHECK(item.frame != nullptr);
+                    CHECK(item.pts == first + static_cast<int>(i));
+                }
+                QueuedFrame item;
+                CHECK(!queue.tryPop(item));
+                CHECK(!queue.popFor(item, std::chrono::milliseconds(1)));
+                CHECK(queue.framesPopped() == capacity);
+
+                // 取空之后还能继续使用
+                CHECK(queue.push(makeFrame(), 100));
+                CHECK(queue.popFor(item, std::chrono::milliseconds(1)));
+                CHECK(item.pts == 100);
+
+                queue.close();
+                CHECK(!queue.push(makeFrame(), 101));
+                CHECK(!queue.popFor(item, std::chrono::milliseconds(1)));
+            }
+        }
+    }
+}
+
+int main() {
+    testOverflow<SpscQueue<int>>();
+    testOverflow<MpmcQueue<int>>();
+    testTwoThreadStress<SpscQueue<int>>();
+    testTwoThreadStress<MpmcQueue<int>>();
+    testMpmcSmallCapacity();
+    testFrameQueueOverflow();
+    std::puts("queue_test passed");
+    return 0;
+}
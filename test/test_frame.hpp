@@ -0,0 +1,47 @@
+// test/test_frame.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+// SIMD 内核测试用的随机帧。宽度取奇数和不是 16 倍数的值，让同一行既经过向量主体又经过标量尾部
+namespace test {
+    inline constexpr int kOddWidths[] = {1, 15, 17, 31, 33, 47, 63, 65, 127, 641};
+
+    inline std::vector<uint8_t> randomBytes(const size_t size) {
+        static std::mt19937 rng(12345);
+        std::vector<uint8_t> bytes(size);
+        for (auto &b: bytes) b = static_cast<uint8_t>(rng());
+        return bytes;
+    }
+
+    // 一帧 yuv420p，行宽留出余量，像素随机；frame 只借用 planes 的内存
+    struct TestFrame {
+        std::vector<uint8_t> planes[3];
+        int stride[3] = {};
+        AVFrame frame{};
+
+        TestFrame(const int width, const int height) {
+            const int chroma_width = (width + 1) / 2;
+            const int chroma_height = (height + 1) / 2;
+            stride[0] = width + 13;
+            stride[1] = stride[2] = chroma_width + 7;
+            planes[0] = randomBytes(static_cast<size_t>(stride[0]) * height);
+            planes[1] = randomBytes(static_cast<size_t>(stride[1]) * chroma_height);
+            planes[2] = randomBytes(static_cast<size_t>(stride[2]) * chroma_height);
+            for (int p = 0; p < 3; ++p) {
+                frame.data[p] = planes[p].data();
+                frame.linesize[p] = stride[p];
+            }
+            frame.width = width;
+            frame.height = height;
+            frame.format = AV_PIX_FMT_YUV420P;
+        }
+    };
+} // namespace test
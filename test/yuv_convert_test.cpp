@@ -0,0 +1,80 @@
+// test/yuv_convert_test.cpp
+// yuv_convert 的 SSE2 路径和标量路径逐字节一致
+#include "check.hpp"
+#include "test_frame.hpp"
+
+#include "yuv_convert.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+using namespace ender::airplay_streamer;
+
+namespace {
+    void testI420ToBgra() {
+        const yuv::Coefficients &k = yuv::coefficients(true, false);
+        for (const int width: test::kOddWidths) {
+            test::TestFrame src(width, 3);
+            const uint8_t *const planes[3] = {src.frame.data[0], src.frame.data[1], src.frame.data[2]};
+            std::vector<uint8_t> full(static_cast<size_t>(width) * 4 * 3);
+            yuv::i420ToBgra(planes, src.stride, full.data(), width * 4, width, 3, k);
+
+            // 每次只转两个像素，全部走标量路径
+            std::vector<uint8_t> scalar(full.size());
+            for (int x = 0; x < width; x += 2) {
+                const uint8_t *const part[3] = {planes[0] + x, planes[1] + x / 2, planes[2] + x / 2};
+                yuv::i420ToBgra(part, src.stride, scalar.data() + 4 * x, width * 4, std::min(2, width - x), 3, k);
+            }
+            CHECK(full == scalar);
+        }
+    }
+
+    void testYuvToPlanarRgb() {
+        const yuv::Coefficients &k = yuv::coefficients(false, true);
+        for (const int width: test::kOddWidths) {
+            const auto y = test::randomBytes(width);
+            const auto u = test::randomBytes(width);
+            const auto v = test::randomBytes(width);
+            std::vector<uint8_t> r(width), g(width), b(width);
+            yuv::yuvToPlanarRgb(y.data(), u.data(), v.data(), r.data(), g.data(), b.data(), width, k);
+
+            // 逐像素调用，全部走标量路径
+            std::vector<uint8_t> sr(width), sg(width), sb(width);
+            for (int x = 0; x < width; ++x) {
+                yuv::yuvToPlanarRgb(&y[x], &u[x], &v[x], &sr[x], &sg[x], &sb[x], 1, k);
+            }
+            CHECK(r == sr);
+            CHECK(g == sg);
+            CHECK(b == sb);
+        }
+    }
+
+    void testI420ToNv12() {
+        for (const int width: test::kOddWidths) {
+            test::TestFrame src(width, 4);
+            const uint8_t *const planes[3] = {src.frame.data[0], src.frame.data[1], src.frame.data[2]};
+            const int chroma_width = (width + 1) / 2;
+            std::vector<uint8_t> y(static_cast<size_t>(width) * 4);
+            std::vector<uint8_t> uv(static_cast<size_t>(chroma_width) * 2 * 2);
+            yuv::i420ToNv12(planes, src.stride, y.data(), width, uv.data(), chroma_width * 2, width, 4);
+            for (int row = 0; row < 4; ++row) {
+                for (int x = 0; x < width; ++x) CHECK(y[row * width + x] == planes[0][row * src.stride[0] + x]);
+            }
+            for (int row = 0; row < 2; ++row) {
+                for (int x = 0; x < chroma_width; ++x) {
+                    CHECK(uv[row * chroma_width * 2 + 2 * x] == planes[1][row * src.stride[1] + x]);
+                    CHECK(uv[row * chroma_width * 2 + 2 * x + 1] == planes[2][row * src.stride[2] + x]);
+                }
+            }
+        }
+    }
+}
+
+int main() {
+    testI420ToBgra();
+    testI420ToNv12();
+    testYuvToPlanarRgb();
+    std::puts("yuv_convert_test passed");
+    return 0;
+}